@@ -0,0 +1,62 @@
+#pragma once
+#include "decoder.h"
+#include "hardware.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_BLOCK_INSTRUCTIONS 32
+#define BLOCK_CACHE_BUCKETS 4096
+
+typedef struct CachedInstruction {
+    instruction_handler_t execute;
+    uint16_t pc;
+    uint8_t length;
+    uint8_t instruction[MAX_INSTRUCTION_SIZE];
+} cached_instruction_t;
+
+/*
+ * A straight-line run of decoded ROM instructions. Blocks are keyed by the
+ * ROM bank mapped at start_pc when they were decoded and never span the
+ * 0x4000 boundary, so a block stays valid for as long as the cartridge is
+ * loaded.
+ */
+typedef uint32_t (*native_block_t)(uint64_t cycle);
+
+typedef struct BasicBlock {
+    uint16_t bank;
+    uint16_t start_pc;
+    uint8_t instruction_count;
+    uint16_t execution_count;
+    bool native_failed;
+    bool may_idle;
+    // Only set for blocks that may idle, see idle_loop.h
+    uint8_t polled_sources;
+    uint8_t polled_pointers;
+    native_block_t native;
+    // Most clocks a compiled block can run before its last instruction
+    uint16_t clocks_before_last;
+    struct BasicBlock *next;
+    cached_instruction_t instructions[];
+} basic_block_t;
+
+typedef struct BlockCache {
+    basic_block_t *buckets[BLOCK_CACHE_BUCKETS];
+    /*
+     * The block and instruction expected to execute next. Reset whenever the
+     * ROM mapping changes since the cursor may point into a bank that is no
+     * longer mapped at its addresses.
+     */
+    basic_block_t *cursor_block;
+    uint8_t cursor_index;
+    uint32_t mapping_generation;
+} BlockCache;
+
+bool is_cacheable_address(uint16_t address);
+basic_block_t *lookup_block(uint16_t pc);
+clock_cycles_t run_cached_instruction(cached_instruction_t *cached);
+clock_cycles_t execute_cached_instruction(void);
+bool block_cursor_continues(uint16_t pc);
+void set_block_cursor(basic_block_t *block);
+void invalidate_block_cursor(void);
+uint32_t get_block_mapping_generation(void);
+void destroy_block_cache(void);
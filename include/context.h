@@ -0,0 +1,42 @@
+#pragma once
+#include "block_cache.h"
+#include "cpu.h"
+#include "hardware.h"
+#include "idle_loop.h"
+#include "interrupts.h"
+#include "jit.h"
+#include "memory.h"
+#include "oam_queue.h"
+#include "ppu.h"
+#include "scheduler.h"
+#include "tile_cache.h"
+#include <pthread.h>
+
+/*
+ * Everything one emulated Gameboy owns. The emulator reaches the instance it
+ * is running through gb, which every thread has to point at the instance
+ * before touching it, so independent instances can run side by side on
+ * different threads.
+ */
+typedef struct GameboyContext {
+    Hardware hardware;
+    CPU cpu;
+    Memory memory;
+    PPU ppu;
+    SpriteStore sprite_store;
+    TileCache tile_cache;
+    Joypad joypad;
+    Timer timer;
+    InterruptState interrupts;
+    Scheduler scheduler;
+    BlockCache block_cache;
+    IdleLoop idle_loop;
+    Jit jit;
+    pthread_mutex_t dots_mutex;
+} gameboy_context_t;
+
+extern _Thread_local gameboy_context_t *gb;
+
+gameboy_context_t *create_context(void);
+void destroy_context(gameboy_context_t *context);
+void set_context(gameboy_context_t *context);
@@ -1,8 +1,27 @@
+#pragma once
+#include "hardware.h"
 #include <stdbool.h>
 #include <stdint.h>
-void *start_cpu(void *);
-void end_cpu(void);
-void toggle_step_mode(void);
+#include <time.h>
+
+enum CPU_MODE {
+    INTERPRETER,
+    BLOCK_CACHE,
+    JIT,
+};
+
+typedef struct CPU {
+    enum CPU_MODE mode;
+    bool step_mode;
+    bool throttled;
+    // Clocks run since the last time the CPU slept off the rest of a frame
+    uint32_t exec_count;
+    struct timespec frame_start;
+} CPU;
+
+void step_cpu(void);
 bool get_step_mode(void);
+void set_cpu_mode(enum CPU_MODE mode);
+enum CPU_MODE get_cpu_mode(void);
+void set_cpu_throttle(bool enabled);
 
-extern uint64_t instructions_left;
@@ -1,5 +1,17 @@
+#pragma once
 #include "hardware.h"
 #include "instructions.h"
 #include <stdint.h>
-clock_cycles_t (*fetch_instruction(void))(uint8_t instruction[MAX_INSTRUCTION_SIZE]);
-clock_cycles_t execute_instruction(clock_cycles_t execute_func(uint8_t instruction[MAX_INSTRUCTION_SIZE]));
+
+typedef clock_cycles_t (*instruction_handler_t)(
+    uint8_t instruction[MAX_INSTRUCTION_SIZE]);
+
+typedef struct OpcodeInfo {
+    instruction_handler_t execute;
+    uint8_t length;        // bytes including the 0xCB prefix and operands
+    clock_cycles_t cycles; // base cost, conditional branches not taken
+} opcode_info_t;
+
+const opcode_info_t *decode_opcode(uint8_t opcode, uint8_t prefixed_opcode);
+const opcode_info_t *fetch_instruction(void);
+clock_cycles_t execute_instruction(const opcode_info_t *opcode_info);
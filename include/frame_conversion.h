@@ -0,0 +1,16 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+enum FRAME_FORMAT {
+    FRAME_RGBA8888,
+    FRAME_RGB565,
+    // One byte per pixel, 0xFF for white
+    FRAME_GRAY8,
+};
+
+void convert_frame(const uint8_t *frame, enum FRAME_FORMAT format,
+                   void *pixels, size_t pitch);
+void convert_frame_lines(const uint8_t *frame, uint8_t first_line,
+                         uint8_t line_count, enum FRAME_FORMAT format,
+                         void *pixels, size_t pitch);
@@ -0,0 +1,177 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Headless interface to the emulator core, built as libgbcore without SDL or
+ * ncurses. The core runs on the calling thread and, unless gb_set_real_time is
+ * enabled, doesn't sleep to keep real time, so frames are produced as fast as
+ * the host can emulate them.
+ *
+ * Every core owns all of its state, so any number of them can run side by
+ * side as long as each one is only used from one thread at a time.
+ */
+
+#define GB_SCREEN_WIDTH 160
+#define GB_SCREEN_HEIGHT 144
+#define GB_BOOT_ROM_SIZE 0x100
+
+// Bits of the mask passed to gb_set_joypad, set while a button is held
+enum GB_BUTTONS {
+    GB_BUTTON_RIGHT = 1 << 0,
+    GB_BUTTON_LEFT = 1 << 1,
+    GB_BUTTON_UP = 1 << 2,
+    GB_BUTTON_DOWN = 1 << 3,
+    GB_BUTTON_A = 1 << 4,
+    GB_BUTTON_B = 1 << 5,
+    GB_BUTTON_SELECT = 1 << 6,
+    GB_BUTTON_START = 1 << 7
+};
+
+typedef struct GameboyCore gb_core_t;
+
+// Returns NULL if the core can't be allocated
+gb_core_t *gb_create(void);
+void gb_destroy(gb_core_t *core);
+
+/*
+ * Both have to be called before gb_load_rom and fail afterwards. Without a
+ * boot ROM, which has to be GB_BOOT_ROM_SIZE bytes, the core starts at the
+ * cartridge entry point with the registers the boot ROM leaves behind.
+ * Nothing is read from or written to disk unless a save directory is set, in
+ * which case battery backed RAM is loaded from it by gb_load_rom and written
+ * back to it by gb_destroy.
+ */
+bool gb_load_boot_rom(gb_core_t *core, const uint8_t *boot_rom, size_t size);
+bool gb_set_save_directory(gb_core_t *core, const char *directory);
+
+/*
+ * Copies the ROM image out of the buffer. Fails if the buffer is too small to
+ * hold a cartridge header, the cartridge type or RAM size isn't supported or a
+ * ROM has already been loaded.
+ */
+bool gb_load_rom(gb_core_t *core, const uint8_t *rom, size_t size);
+
+/*
+ * Both run at least as long as asked, overshooting by at most one instruction
+ * or HALT step, and return false if no ROM is loaded or the CPU hit an
+ * unimplemented instruction.
+ * A frame ends at the start of VBlank, or after a full frame's worth of
+ * cycles while the LCD is off.
+ */
+bool gb_run_cycles(gb_core_t *core, uint64_t cycles);
+bool gb_run_frames(gb_core_t *core, uint32_t frames);
+uint64_t gb_get_cycles(const gb_core_t *core);
+
+/*
+ * Runs a single instruction, along with any interrupt dispatch in front of it,
+ * or a single step of HALT, for stepping through code. Idle loops aren't
+ * skipped and no compiled blocks run. Returns false like gb_run_cycles.
+ */
+bool gb_step(gb_core_t *core);
+
+// Sleeps off what is left of every frame to run at the speed of the hardware
+void gb_set_real_time(gb_core_t *core, bool enabled);
+
+// Empty until a ROM is loaded
+const char *gb_get_cartridge_title(const gb_core_t *core);
+
+void gb_set_joypad(gb_core_t *core, uint8_t buttons);
+
+enum GB_CPU_MODE {
+    // The default
+    GB_CPU_INTERPRETER,
+    // Runs decoded blocks of ROM code and skips over idle polling loops
+    GB_CPU_CACHED,
+    // Cached, with hot blocks compiled to native x86-64 code
+    GB_CPU_JIT
+};
+
+/*
+ * All modes produce the same results, best switched between runs. Returns
+ * false if the JIT isn't supported on this platform, the core uses the cached
+ * mode instead.
+ */
+bool gb_set_cpu_mode(gb_core_t *core, enum GB_CPU_MODE mode);
+
+typedef struct GameboyIdleLoopStats {
+    uint64_t skips;
+    uint64_t skipped_iterations;
+    uint64_t skipped_cycles;
+} gb_idle_loop_stats_t;
+
+// Polling loop passes the cached mode didn't have to run so far
+gb_idle_loop_stats_t gb_get_idle_loop_stats(const gb_core_t *core);
+
+typedef struct GameboyJitStats {
+    uint64_t blocks_compiled;
+    uint64_t block_hits;
+    uint64_t native_instructions;
+    uint64_t early_exits;
+    uint64_t deadline_fallbacks;
+    uint64_t compile_failures;
+} gb_jit_stats_t;
+
+/*
+ * Blocks the JIT compiled and ran so far, along with how many of their
+ * instructions are native code, how many blocks returned early and how many
+ * were stepped instead because an event came due inside them.
+ */
+gb_jit_stats_t gb_get_jit_stats(const gb_core_t *core);
+
+/*
+ * Only draws one frame in every `frames`, 1 (the default) draws all of them.
+ * Skipped frames keep their timing and interrupts and leave the last drawn
+ * frame in the framebuffer.
+ */
+void gb_set_frame_skip(gb_core_t *core, uint8_t frames);
+
+/*
+ * Picks the frame skip from how many real-time deadlines were missed lately,
+ * so it only has an effect along with gb_set_real_time.
+ */
+void gb_set_adaptive_frame_skip(gb_core_t *core, bool enabled);
+
+enum GB_RENDERER {
+    // The default, draws a line at a time from cached tiles
+    GB_RENDERER_SCANLINE,
+    // Draws one pixel per step the way the original renderer did, for debugging
+    GB_RENDERER_PIXEL
+};
+
+void gb_set_renderer(gb_core_t *core, enum GB_RENDERER renderer);
+
+/*
+ * Draws frames on a thread of its own, so a frame is drawn while the next one
+ * already runs. Fetching the framebuffer waits for the frames run so far. Best
+ * switched between gb_run_frames calls, the frame in progress may otherwise
+ * come out partly wrong. Enabling it fails until a ROM is loaded, since the
+ * thread starts from a copy of the cartridge's VRAM and OAM.
+ */
+bool gb_set_render_thread(gb_core_t *core, bool enabled);
+
+enum GB_PIXEL_FORMAT {
+    GB_PIXEL_RGBA8888,
+    GB_PIXEL_RGB565,
+    // One byte per pixel, 0xFF for white
+    GB_PIXEL_GRAY8
+};
+
+/*
+ * The last complete frame, GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT pixels, row by
+ * row, as shades from 0 (white) to 3 (black). Stays unchanged until the next
+ * call to any of the framebuffer functions. Nothing is converted, so this is
+ * all that's needed to hash or compare frames.
+ */
+const uint8_t *gb_get_indexed_framebuffer(const gb_core_t *core);
+
+// Converts the last complete frame, rows start pitch bytes apart in pixels
+void gb_convert_framebuffer(const gb_core_t *core, enum GB_PIXEL_FORMAT format,
+                            void *pixels, size_t pitch);
+
+/*
+ * The last complete frame converted to RGBA8888, in a buffer owned by the core
+ * that is overwritten on the next call.
+ */
+const uint32_t *gb_get_framebuffer(const gb_core_t *core);
@@ -2,4 +2,5 @@
 void open_window(void);
 void close_window(void);
 void update_renderer(void);
-void update_window_title(char * title);
+void redraw_window(void);
+void update_window_title(const char *title);
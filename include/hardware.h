@@ -1,4 +1,5 @@
 #pragma once
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -13,6 +14,7 @@
 #define REGISTER_COUNT 8
 #define RESOLUTION_SCALE 6
 #define TILE_MAP_WIDTH 256
+#define NEW_FRAME_BIT 0x80
 #define DISPLAY_WIDTH 160
 #define DISPLAY_HEIGHT 144
 #define SCAN_LINES 154
@@ -49,14 +51,52 @@ typedef enum {
   THIRTY_TWO_CLOCKS = 32
 } clock_cycles_t;
 
+/*
+ * Flags produced by the last arithmetic operation are only worked out when
+ * something reads them. Bits of F the operation doesn't produce are kept in
+ * registers[F] as usual.
+ */
+typedef enum FlagOperation {
+  FLAGS_EVALUATED,
+  FLAGS_ADD,
+  FLAGS_SUB,
+  FLAGS_ADD16,
+  FLAGS_INC,
+  FLAGS_DEC
+} flag_operation_t;
+
+typedef struct LazyFlags {
+  flag_operation_t operation;
+  uint16_t val_1;
+  uint16_t val_2;
+  uint8_t carry;
+} lazy_flags_t;
+
 enum INTERRUPT_STATE {
   NOTHING = 0,
   DISABLE = 1,
   ENABLE = 2,
 };
 
+/*
+ * Three frames of shades, 0 (white) to 3 (black), handed between the PPU and
+ * whoever presents them without locking. convert_frame turns them into
+ * colors. The PPU draws into back, publishing a finished frame swaps it with
+ * shared and the presenter swaps front with shared when a new one is there.
+ * Every frame carries a hash of each of its lines, so a presenter can tell
+ * which lines changed since the frame it showed last.
+ */
+typedef struct DisplayBuffers {
+  uint8_t *frames[3];
+  uint64_t line_hashes[3][DISPLAY_HEIGHT];
+  uint8_t back;
+  _Atomic uint8_t shared; // with NEW_FRAME_BIT set until it's picked up
+  uint8_t front;
+} DisplayBuffers;
+
 typedef struct Hardware {
-  uint32_t *display_buffer;
+  // Shared with the render worker's context while one is running
+  DisplayBuffers *display_buffers;
   uint8_t registers[REGISTER_COUNT];
   uint16_t sp;
   uint16_t base_sp;
@@ -75,6 +115,7 @@ typedef struct Hardware {
   bool step_mode;
   bool oam_dma_started;
   bool is_halted;
+  lazy_flags_t lazy_flags;
 } Hardware;
 
 typedef struct Joypad {
@@ -83,6 +124,13 @@ typedef struct Joypad {
   uint8_t inputs;
 } Joypad;
 
+typedef struct Timer {
+  // DIV is the upper byte of a counter last reset on this cycle
+  uint64_t counter_reset_at;
+  // Cycle TIMA in IO RAM was last brought up to date on
+  uint64_t synced_at;
+} Timer;
+
 typedef enum JoypadButtons {
   RIGHT,
   LEFT,
@@ -95,10 +143,13 @@ typedef enum JoypadButtons {
 } joypad_t;
 
 
-void initialize_hardware(void);
+bool initialize_hardware(void);
+void skip_boot_rom(void);
+Hardware *get_hardware(void);
 void destroy_hardware(void);
 void initialize_io(void);
-void load_rom(FILE *);
+bool load_rom(FILE *rom, const uint8_t *boot_rom,
+              const char *save_directory);
 uint8_t privileged_get_memory_byte(uint16_t address);
 uint8_t get_memory_byte(uint16_t address);
 void privileged_set_memory_byte(uint16_t address, uint8_t byte);
@@ -106,9 +157,18 @@ void set_memory_byte(uint16_t address, uint8_t byte);
 uint8_t get_flag(flags_t flag);
 void set_flag(flags_t flag);
 void reset_flag(flags_t flag);
-void set_display_pixel(uint8_t x, uint8_t y,
-                       uint32_t pixel_color);
-uint32_t *get_display_buffer(void);
+void set_flags(bool z, bool n, bool h, bool c);
+void set_flags_add(uint8_t val_1, uint8_t val_2, uint8_t carry);
+void set_flags_sub(uint8_t val_1, uint8_t val_2, uint8_t carry);
+void set_flags_add16(uint16_t val_1, uint16_t val_2);
+void set_flags_inc(uint8_t val);
+void set_flags_dec(uint8_t val);
+void set_display_pixel(uint8_t x, uint8_t y, uint8_t shade);
+uint8_t *get_display_buffer(void);
+void publish_display_buffer(void);
+const uint8_t *get_latest_frame(void);
+bool is_new_frame_ready(void);
+const uint64_t *get_latest_line_hashes(void);
 void set_register(reg_t dst, uint8_t val);
 uint8_t get_register(reg_t src);
 void set_decoded_instruction(const char *str, ...);
@@ -129,6 +189,7 @@ enum INTERRUPT_STATE get_interrupt_state(void);
 void append_instruction(uint8_t pos);
 uint8_t *get_instruction(void);
 void inc_instruction_count(void);
+void add_instruction_count(uint64_t count);
 void set_is_implemented(bool val);
 bool get_is_implemented(void);
 char *get_decoded_instruction(void);
@@ -147,7 +208,10 @@ bool get_oam_dma_transfer(void);
 void set_oam_dma_transfer(bool oam_dma_transfer_is_enabled);
 
 // TIMER
-void update_timer(clock_cycles_t clocks);
+uint8_t read_timer_register(uint16_t address);
+void write_timer_register(uint16_t address, uint8_t byte);
+uint64_t get_next_timer_change_cycle(void);
+void handle_timer_event(void);
 
 // HALT instruction
 void set_halted(bool halt_state);
@@ -0,0 +1,53 @@
+#pragma once
+#include "block_cache.h"
+#include "hardware.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct IdleLoopStats {
+    uint64_t skips;
+    uint64_t skipped_iterations;
+    uint64_t skipped_cycles;
+} idle_loop_stats_t;
+
+#define NUM_OF_LOOP_REGISTERS 8
+
+// What a loop reads that changes without a scheduled event
+enum POLLED_SOURCES {
+    POLLS_LY = 1 << 0,
+    // STAT, VRAM and OAM, which also read differently between modes
+    POLLS_PPU_MODE = 1 << 1,
+    POLLS_TIMER = 1 << 2,
+    POLLS_ANYTHING = POLLS_LY | POLLS_PPU_MODE | POLLS_TIMER
+};
+
+// Register pairs a loop reads through, resolved once its registers are known
+enum POLLED_POINTERS {
+    READS_THROUGH_BC = 1 << 0,
+    READS_THROUGH_DE = 1 << 1,
+    READS_THROUGH_HL = 1 << 2,
+    READS_THROUGH_C = 1 << 3
+};
+
+typedef struct LoopVisit {
+    const basic_block_t *block;
+    uint64_t cycle;
+    uint64_t instruction_count;
+    uint64_t handled_events;
+    // First cycle anything the loop polls reads differently at
+    uint64_t next_change;
+    uint8_t registers[NUM_OF_LOOP_REGISTERS];
+    uint16_t sp;
+} loop_visit_t;
+
+typedef struct IdleLoop {
+    loop_visit_t previous_visit;
+    idle_loop_stats_t stats;
+} IdleLoop;
+
+bool is_idle_loop_candidate(const cached_instruction_t *instructions,
+                            uint8_t count);
+void find_polled_sources(basic_block_t *block);
+clock_cycles_t skip_idle_loop(const basic_block_t *block);
+idle_loop_stats_t get_idle_loop_stats(void);
+void print_idle_loop_stats(void);
@@ -11,6 +11,7 @@ typedef enum Interrupts {
 } interrupts_t;
 
 #define NUM_OF_INTERRUPTS 5
+#define NUM_OF_STAT_SOURCES 4
 
 typedef enum {
     MODE_0_INT = 3,
@@ -20,9 +21,24 @@ typedef enum {
     INVALID_STAT_SOURCE
 } stat_interrupts_t;
 
+typedef struct InterruptState {
+    uint32_t serviced_interrupts[NUM_OF_INTERRUPTS];
+    uint32_t serviced_stat_interrupts[NUM_OF_STAT_SOURCES];
+    uint8_t stat_line;
+    // IE and IF, mirrored in IO RAM for reads
+    uint8_t enabled;
+    uint8_t requested;
+    // Worked out again only when IE, IF, IME or the EI/DI state change
+    uint8_t pending;
+    bool needs_handling;
+} InterruptState;
+
 clock_cycles_t handle_interrupts(void);
 void close_interrupt_handler(void);
 void set_interrupts_flag(interrupts_t interrupt);
+void set_interrupt_flags(uint8_t flags);
+void set_interrupt_enable(uint8_t enable);
+void update_pending_interrupts(void);
 
 
 void trigger_stat_source(stat_interrupts_t stat_source);
@@ -0,0 +1,30 @@
+#pragma once
+#include "hardware.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JitStats {
+    uint64_t blocks_compiled;
+    uint64_t block_hits;
+    uint64_t native_instructions;
+    uint64_t early_exits;
+    uint64_t deadline_fallbacks;
+    uint64_t compile_failures;
+} jit_stats_t;
+
+typedef struct Jit {
+    jit_stats_t stats;
+    uint8_t *arena;
+    size_t arena_used;
+    // What the running block was entered with, see check_block_exit
+    uint32_t block_generation;
+    uint64_t entry_deadline;
+    bool stop;
+} Jit;
+
+bool initialize_jit(void);
+void destroy_jit(void);
+clock_cycles_t execute_jit_block(clock_cycles_t clocks);
+jit_stats_t get_jit_stats(void);
+void print_jit_stats(void);
@@ -1,11 +1,15 @@
 #pragma once
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
-#define MAX_SAVE_DATA_NAME_SIZE 40
+#define MAX_SAVE_DATA_NAME_SIZE 4096
 #define MAX_TITLE_SIZE 16
 #define ROM_BANK_SIZE 0x4000
 #define RAM_BANK_SIZE 0x2000
+#define MEMORY_PAGE_SIZE 0x100
+#define MEMORY_PAGE_COUNT 0x100
 
 typedef struct {
   char title[MAX_TITLE_SIZE + 1];
@@ -20,6 +24,12 @@ typedef struct {
   void (*save_data)(FILE *save_location);
   void (*load_save_data)(FILE *save_location);
   void (*destroy_memory)(void);
+  uint16_t (*get_rom_bank)(uint16_t address);
+  /*
+   * Host memory currently mapped at ROM_BANK_00_BASE, ROM_BANK_NN_BASE or
+   * EX_RAM_BASE, or NULL if accesses there have to go through the handlers
+   */
+  uint8_t *(*get_bank_memory)(uint16_t base);
 } MBC;
 
 struct RTC {
@@ -30,6 +40,72 @@ struct RTC {
   uint8_t DH;
 };
 
+typedef struct MBC0State {
+  uint8_t *rom;
+  uint8_t *ram;
+} MBC0State;
+
+typedef struct MBC1State {
+  uint8_t **rom_banks;
+  uint8_t max_rom_banks;
+  uint8_t **ram_banks;
+  uint8_t max_ram_banks;
+  uint8_t bank_1_mask;
+  bool ram_bank_enabled;
+  bool rom_bank_enabled;
+  bool is_large_cartridge;
+  uint8_t bank_register_1;
+  uint8_t bank_register_2;
+  uint8_t bank_mode_select;
+} MBC1State;
+
+typedef struct MBC3State {
+  struct RTC rtc;
+  struct RTC latched_rtc;
+  struct RTC *current_rtc;
+  uint8_t **rom_banks;
+  uint8_t max_rom_banks;
+  uint8_t **ram_banks;
+  uint8_t max_ram_banks;
+  bool ram_bank_and_rtc_enabled;
+  bool rom_bank_enabled;
+  uint8_t latch_register;
+  uint8_t current_rom_bank;
+  uint8_t ram_rtc_select;
+  pthread_t rtc_id;
+  bool close_rtc;
+} MBC3State;
+
+typedef struct Memory {
+  MBC mbc;
+  // State of whichever MBC the cartridge uses
+  union {
+    MBC0State mbc0;
+    MBC1State mbc1;
+    MBC3State mbc3;
+  };
+  bool dmg_mapped;
+  // Only the IO registers and HRAM are reachable during OAM DMA
+  bool bus_blocked;
+  uint8_t *dmg;
+  uint8_t *vram;
+  uint8_t *wram;
+  uint8_t *oam;
+  uint8_t *io_ram;
+  // Both empty unless saves were asked for when the ROM was loaded
+  char save_directory[MAX_SAVE_DATA_NAME_SIZE];
+  char save_location_filename[MAX_SAVE_DATA_NAME_SIZE];
+  char cartridge_title[MAX_TITLE_SIZE + 1];
+  /*
+   * One entry per 256 byte page of the address space pointing at the host
+   * memory behind it. Pages that are NULL (IO, VRAM, OAM and MBC registers)
+   * go through the handlers instead, VRAM and OAM so the PPU can catch up
+   * before the CPU touches what it draws with.
+   */
+  uint8_t *read_pages[MEMORY_PAGE_COUNT];
+  uint8_t *write_pages[MEMORY_PAGE_COUNT];
+} Memory;
+
 enum MEMORY_MAP {
   ROM_BANK_00_BASE = 0x0000,
   ROM_BANK_NN_BASE = 0x4000,
@@ -102,3 +178,8 @@ void destroy_memory(void);
 struct RTC *get_rtc(void);
 struct RTC *get_current_rtc(void);
 struct RTC *get_latched_rtc(void);
+uint16_t get_rom_bank(uint16_t address);
+bool is_dmg_mapped(void);
+const char *get_cartridge_title(void);
+void set_memory_bus_blocked(bool blocked);
+const uint8_t *get_oam_dma_source(uint8_t page);
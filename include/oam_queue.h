@@ -1,3 +1,4 @@
+#pragma once
 #include "hardware.h"
 #include <stdint.h>
 #define MAX_OBJECTS 10
@@ -12,12 +13,20 @@ struct ObjectRowData {
     uint8_t DMG_palette;
 };
 
+/*
+ * Objects selected during OAM scan, in OAM order. Once the scan is done they
+ * are drawn into object_line, encoded as described in line_kernels.h, which is
+ * all mode 3 reads.
+ */
 typedef struct SpriteStore {
     struct ObjectRowData selected_objects[MAX_OBJECTS];
     uint8_t length;
+    uint8_t object_line[DISPLAY_WIDTH];
 } SpriteStore;
 
-clock_cycles_t try_oam_dma_transfer(void);
+void start_oam_dma_transfer(void);
+void handle_oam_dma_event(void);
 void initialize_sprite_store(void);
 SpriteStore *get_sprite_store(void);
 void add_sprite(uint16_t object_no);
+void build_object_line(void);
@@ -1,7 +1,15 @@
-#include <pthread.h>
+#pragma once
+#include "ppu_registers.h"
+#include "render_worker.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+enum PPU_RENDERER {
+    SCANLINE_RENDERER,
+    // Draws one pixel per step the way the original renderer did, for debugging
+    PIXEL_RENDERER,
+};
+
 typedef struct PPU {
     uint32_t available_dots;
     uint64_t consumed_dots;
@@ -12,17 +20,33 @@ typedef struct PPU {
     bool window_rendered;
     uint8_t mode;
     bool ready_to_render;
+    bool window_enabled;
+    uint8_t object_index;
+    uint64_t synced_at;
+    enum PPU_RENDERER renderer;
+    PPURegisters registers;
+    // Only one frame in every frame_skip is drawn, the rest keep their timing
+    uint8_t frame_skip;
+    uint8_t frames_until_drawn;
+    bool skipping_frame;
+    bool adaptive_frame_skip;
+    uint8_t frames_on_time;
+    // Draws the pixels when set, the PPU only logs what they depend on
+    RenderWorker *render_worker;
 } PPU;
 
-extern PPU ppu;
-extern pthread_mutex_t display_buffer_mutex;
-extern pthread_mutex_t dots_mutex;
-
 void initialize_ppu(void);
-void run_ppu(uint16_t dots);
-void *start_ppu(void *arg);
-void render_loop(void);
+void run_ppu(uint32_t dots);
+void catch_up_ppu(void);
+void sync_ppu(void);
+uint64_t get_next_ppu_change_cycle(void);
+uint64_t get_next_line_cycle(void);
+void handle_ppu_event(void);
 uint8_t get_x_pixel(void);
 uint8_t get_y_pixel(void);
 uint8_t get_window_line(void);
-void end_ppu(void);
+void set_ppu_renderer(enum PPU_RENDERER renderer);
+void draw_pixels(uint8_t x_start, uint8_t x_end);
+void set_frame_skip(uint8_t frames);
+void set_adaptive_frame_skip(bool adaptive);
+void report_frame_deadline(bool missed);
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Copies of the registers the PPU draws with, kept up to date by every write
+ * to them together with what is derived from them, so neither the renderer
+ * nor run_ppu has to go through the memory bus.
+ */
+typedef struct PPURegisters {
+    uint8_t lcdc;
+    uint8_t stat_selects; // STAT bits 3-6, the enabled interrupt sources
+    bool lyc_coincidence; // STAT bit 2
+    uint8_t scy;
+    uint8_t scx;
+    uint8_t lyc;
+    uint8_t bgp;
+    uint8_t obp0;
+    uint8_t obp1;
+    uint8_t wy;
+    uint8_t wx;
+    // From LCDC
+    uint16_t bg_tile_map;
+    uint16_t window_tile_map;
+    uint16_t tile_starts[256]; // by tile index, for the addressing mode in use
+    uint8_t object_height;
+    // Shades by color ID
+    uint8_t bg_shades[4];
+    uint8_t obj_shades[2][4];
+} PPURegisters;
+
+void initialize_ppu_registers(void);
+void update_ppu_register(uint16_t address, uint8_t byte);
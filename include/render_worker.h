@@ -0,0 +1,42 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Pixel generation on a thread of its own. The PPU keeps its timing, STAT, LY
+ * and interrupts on the CPU thread and logs everything the pixels depend on
+ * in the order it happens: writes to VRAM, OAM and the PPU registers, the
+ * object scan, the runs of pixels mode 3 draws and the end of every frame.
+ * The worker replays the log against its own copy of VRAM, OAM and the
+ * registers, so frame N is drawn while the CPU already runs frame N + 1.
+ */
+enum RENDER_COMMAND_TYPE {
+    RENDER_WRITE,
+    RENDER_SCAN_OBJECTS,
+    RENDER_OBJECT_LINE,
+    RENDER_PIXELS,
+    RENDER_PUBLISH,
+};
+
+typedef struct RenderCommand {
+    uint8_t type;
+    uint8_t line;
+    // The objects first up to end for a scan, the pixels for a run
+    uint8_t first;
+    uint8_t end;
+    uint8_t window_line;
+    bool window_enabled;
+    uint8_t byte;
+    uint16_t address;
+} render_command_t;
+
+typedef struct RenderWorker RenderWorker;
+
+bool start_render_worker(void);
+void stop_render_worker(void);
+void flush_render_worker(void);
+void log_render_write(uint16_t address, uint8_t byte);
+void log_object_scan(uint8_t first, uint8_t end);
+void log_object_line(void);
+void log_pixels(uint8_t x_start, uint8_t x_end);
+void log_frame_end(void);
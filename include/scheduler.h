@@ -0,0 +1,35 @@
+#pragma once
+#include "hardware.h"
+#include <stdint.h>
+
+/*
+ * Hardware that runs alongside the CPU is only updated when something it does
+ * becomes visible to the CPU. Each component keeps one event in a queue
+ * ordered by the cycle it is due at, and the CPU only has to check the
+ * earliest deadline after every instruction.
+ */
+typedef enum Events {
+    TIMER_EVENT,
+    PPU_EVENT,
+    OAM_DMA_EVENT,
+    NUM_OF_EVENTS
+} event_t;
+
+// Binary min-heap of events ordered by deadline
+typedef struct Scheduler {
+    uint64_t cycles;
+    uint64_t next_deadline;
+    uint64_t handled_events;
+    uint64_t deadlines[NUM_OF_EVENTS];
+    event_t queue[NUM_OF_EVENTS];
+    int queue_position[NUM_OF_EVENTS];
+    int queue_length;
+} Scheduler;
+
+void initialize_scheduler(void);
+uint64_t get_cycles(void);
+uint64_t get_next_event_cycle(void);
+uint64_t get_handled_event_count(void);
+void schedule_event(event_t event, uint64_t cycle);
+void cancel_event(event_t event);
+void advance_cycles(clock_cycles_t clocks);
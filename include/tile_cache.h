@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TILE_DATA_BASE 0x8000
+#define TILE_DATA_END 0x9800
+#define TILE_SIZE 16
+#define TILE_COUNT ((TILE_DATA_END - TILE_DATA_BASE) / TILE_SIZE)
+
+typedef struct TileCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+} tile_cache_stats_t;
+
+/*
+ * Tile rows decoded into one color ID per pixel, left to right and mirrored
+ * for objects flipped in x. A tile is decoded again the first time one of its
+ * rows is needed after a write into its 16 bytes.
+ */
+typedef struct TileCache {
+    uint8_t rows[TILE_COUNT][2][8][8];
+    bool dirty[TILE_COUNT];
+    tile_cache_stats_t stats;
+} TileCache;
+
+void initialize_tile_cache(void);
+void invalidate_tile(uint16_t address);
+const uint8_t *get_tile_row(uint16_t tile_start, uint8_t row, bool x_flipped);
+tile_cache_stats_t get_tile_cache_stats(void);
+void print_tile_cache_stats(void);
@@ -1,5 +1,5 @@
 #pragma once
-#include <ncurses.h>
+#include <stdbool.h>
 #include <stdint.h>
 #define DMG_SIZE 0x100
 #define SECTOR_SIZE 4096
@@ -10,13 +10,11 @@ static inline uint16_t two_u8s_to_u16(uint8_t low, uint8_t high) {
     return (uint16_t)(high << 8 | low);
 }
 
-void mvwprintwhcenter(WINDOW *win, int row, int row_start,
-                      int width, const char *str, ...);
-
 uint16_t post_inc(uint16_t *val);
 
 bool half_carry_on_subtract(uint8_t val_1, uint8_t val_2, uint8_t carry);
 bool half_carry_on_add(uint8_t val_1, uint8_t val_2, uint8_t carry);
+bool half_carry_on_add16(uint16_t val_1, uint16_t val_2);
 uint8_t sub(uint8_t val_1, uint8_t val_2, uint8_t carry);
 uint8_t add(uint8_t val_1, uint8_t val_2, uint8_t carry);
 uint16_t addu16(uint16_t val_1, uint16_t val_2);
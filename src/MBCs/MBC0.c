@@ -1,16 +1,16 @@
 #include "memory.h"
+#include "context.h"
 #include "utils.h"
 #include <stdlib.h>
 
-static uint8_t *rom;
-static uint8_t *ram;
-
 static uint8_t mbc0_get_memory_byte(uint16_t address);
 static void mbc0_set_memory_byte(uint16_t address, uint8_t byte);
 static uint32_t mbc0_load_rom(FILE *rom);
 static void destroy_mbc0(void);
 static void mbc0_load_save_data(FILE *save_location);
 static void mbc0_save_data(FILE *save_location);
+static uint16_t mbc0_get_rom_bank(uint16_t address);
+static uint8_t *mbc0_get_bank_memory(uint16_t base);
 
 MBC initialize_mbc0(void) {
     MBC mbc0;
@@ -20,13 +20,15 @@ MBC initialize_mbc0(void) {
     mbc0.destroy_memory = &destroy_mbc0;
     mbc0.load_save_data = &mbc0_load_save_data;
     mbc0.save_data = &mbc0_save_data;
-    rom = calloc(VRAM_BASE - ROM_BANK_00_BASE, sizeof(uint8_t));
-    if (!rom) {
+    mbc0.get_rom_bank = &mbc0_get_rom_bank;
+    mbc0.get_bank_memory = &mbc0_get_bank_memory;
+    gb->memory.mbc0.rom = calloc(VRAM_BASE - ROM_BANK_00_BASE, sizeof(uint8_t));
+    if (!gb->memory.mbc0.rom) {
         fprintf(stderr, "Unable to allocate memory for ROM");
         exit(1);
     }
-    ram = calloc(WRAM_BASE - EX_RAM_BASE, sizeof(uint8_t));
-    if (!ram) {
+    gb->memory.mbc0.ram = calloc(WRAM_BASE - EX_RAM_BASE, sizeof(uint8_t));
+    if (!gb->memory.mbc0.ram) {
         fprintf(stderr, "Unable to allocate memory for EXRAM");
         exit(1);
     }
@@ -35,20 +37,20 @@ MBC initialize_mbc0(void) {
 }
 
 static void destroy_mbc0(void) {
-    if (rom) {
-        free(rom);
-        rom = NULL;
+    if (gb->memory.mbc0.rom) {
+        free(gb->memory.mbc0.rom);
+        gb->memory.mbc0.rom = NULL;
     }
 
-    if (ram) {
-        free(ram);
-        ram = NULL;
+    if (gb->memory.mbc0.ram) {
+        free(gb->memory.mbc0.ram);
+        gb->memory.mbc0.ram = NULL;
     }
 }
 
 static uint32_t mbc0_load_rom(FILE *cartridge) {
-    fread(rom, 1, ROM_BANK_SIZE * 2, cartridge);
-    uint32_t hash = crc32b(rom, NULL);
+    fread(gb->memory.mbc0.rom, 1, ROM_BANK_SIZE * 2, cartridge);
+    uint32_t hash = crc32b(gb->memory.mbc0.rom, NULL);
     return hash;
 }
 
@@ -62,11 +64,22 @@ static void mbc0_load_save_data(FILE *save_location) {
     return;
 }
 
+static uint16_t mbc0_get_rom_bank(uint16_t address) {
+    return address >= ROM_BANK_NN_BASE ? 1 : 0;
+}
+
+static uint8_t *mbc0_get_bank_memory(uint16_t base) {
+    if (base >= EX_RAM_BASE) {
+        return gb->memory.mbc0.ram;
+    }
+    return &gb->memory.mbc0.rom[base];
+}
+
 static uint8_t mbc0_get_memory_byte(uint16_t address) {
     if (address >= ROM_BANK_00_BASE && address < VRAM_BASE) {
-        return rom[address];
+        return gb->memory.mbc0.rom[address];
     } else if (address >= EX_RAM_BASE && address < WRAM_BASE) {
-        return ram[address - EX_RAM_BASE];
+        return gb->memory.mbc0.ram[address - EX_RAM_BASE];
     }
     fprintf(stderr, "Invalid memory read in MBC0");
     exit(1);
@@ -76,7 +89,7 @@ static void mbc0_set_memory_byte(uint16_t address, uint8_t byte) {
     if (address >= ROM_BANK_00_BASE && address < VRAM_BASE) {
         return;
     } else if (address >= EX_RAM_BASE && address < WRAM_BASE) {
-        ram[address - EX_RAM_BASE] = byte;
+        gb->memory.mbc0.ram[address - EX_RAM_BASE] = byte;
         return;
     }
     fprintf(stderr, "Invalid memory write in MBC0");
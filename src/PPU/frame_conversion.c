@@ -0,0 +1,38 @@
+#include "frame_conversion.h"
+#include "hardware.h"
+#include "line_kernels.h"
+
+/*
+ * Converts a whole frame of shades into pixels of the given format, with rows
+ * starting pitch bytes apart. Only done for frames that are actually shown or
+ * saved, the core itself never needs the colors.
+ */
+void convert_frame(const uint8_t *frame, enum FRAME_FORMAT format,
+                   void *pixels, size_t pitch) {
+    convert_frame_lines(frame, 0, DISPLAY_HEIGHT, format, pixels, pitch);
+}
+
+// Same for line_count lines from first_line on, pixels points at the first
+void convert_frame_lines(const uint8_t *frame, uint8_t first_line,
+                         uint8_t line_count, enum FRAME_FORMAT format,
+                         void *pixels, size_t pitch) {
+    const line_kernels_t *kernels = get_line_kernels();
+    uint8_t *row = pixels;
+    for (uint8_t y = first_line; y < first_line + line_count; y++) {
+        const uint8_t *shades = &frame[y * DISPLAY_WIDTH];
+        switch (format) {
+            case FRAME_RGBA8888:
+                kernels->shades_to_rgba8888((uint32_t *)row, shades,
+                                            DISPLAY_WIDTH);
+                break;
+            case FRAME_RGB565:
+                kernels->shades_to_rgb565((uint16_t *)row, shades,
+                                          DISPLAY_WIDTH);
+                break;
+            case FRAME_GRAY8:
+                kernels->shades_to_gray(row, shades, DISPLAY_WIDTH);
+                break;
+        }
+        row += pitch;
+    }
+}
@@ -2,8 +2,10 @@
 #include "SDL_pixels.h"
 #include "SDL_render.h"
 #include "SDL_video.h"
+#include "context.h"
 #include "debug.h"
 #include "decoder.h"
+#include "frame_conversion.h"
 #include "hardware.h"
 #include "ppu.h"
 #include <SDL.h>
@@ -16,6 +18,11 @@ SDL_Event event;
 SDL_Renderer *renderer;
 SDL_Texture *texture;
 SDL_Window *window;
+// Line hashes of what the texture holds, nothing until the first frame
+static uint64_t texture_hashes[DISPLAY_HEIGHT];
+static bool texture_filled = false;
+// False while the window needs presenting again whatever the texture holds
+static bool texture_current = false;
 
 void open_window(void) {
     SDL_Init(SDL_INIT_VIDEO);
@@ -37,7 +44,7 @@ void close_window(void) {
     SDL_Quit();
 }
 
-void update_window_title(char *title) {
+void update_window_title(const char *title) {
     char title_buffer[MAX_TITLE_SIZE + 1];
     strncpy(title_buffer, title, MAX_TITLE_SIZE);
     title_buffer[MAX_TITLE_SIZE] = '\0';
@@ -45,12 +52,49 @@ void update_window_title(char *title) {
     return;
 }
 
+// Asks for the next frame to be presented even if none of its lines changed
+void redraw_window(void) { texture_current = false; }
+
+// Uploads line_count lines of the frame from first_line on into the texture
+static void upload_lines(const uint8_t *frame, uint8_t first_line,
+                         uint8_t line_count) {
+    const SDL_Rect LINES = {0, first_line, DISPLAY_WIDTH, line_count};
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, &LINES, &pixels, &pitch) == 0) {
+        convert_frame_lines(frame, first_line, line_count, FRAME_RGBA8888,
+                            pixels, (size_t)pitch);
+        SDL_UnlockTexture(texture);
+    }
+}
+
+/*
+ * Only the runs of lines whose hash differs from what the texture holds are
+ * uploaded, and a frame identical to the one on screen isn't presented again.
+ */
 void update_renderer(void) {
-    ppu.ready_to_render = false;
-    pthread_mutex_lock(&display_buffer_mutex);
-    SDL_UpdateTexture(texture, NULL, get_display_buffer(),
-                      DISPLAY_WIDTH * sizeof(uint32_t));
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    pthread_mutex_unlock(&display_buffer_mutex);
-    SDL_RenderPresent(renderer);
+    const uint8_t *frame = get_latest_frame();
+    const uint64_t *line_hashes = get_latest_line_hashes();
+    bool changed = !texture_current;
+    uint8_t y = 0;
+    while (y < DISPLAY_HEIGHT) {
+        if (texture_filled && line_hashes[y] == texture_hashes[y]) {
+            y++;
+            continue;
+        }
+        const uint8_t FIRST_LINE = y;
+        while (y < DISPLAY_HEIGHT &&
+               (!texture_filled || line_hashes[y] != texture_hashes[y])) {
+            texture_hashes[y] = line_hashes[y];
+            y++;
+        }
+        upload_lines(frame, FIRST_LINE, (uint8_t)(y - FIRST_LINE));
+        changed = true;
+    }
+    texture_filled = true;
+    texture_current = true;
+    if (changed) {
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        SDL_RenderPresent(renderer);
+    }
 }
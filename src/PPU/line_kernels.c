@@ -0,0 +1,359 @@
+#include "line_kernels.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LINE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Scalar kernels, plus SSE2 and AVX2 ones on x86-64. The widest set the CPU
+ * supports is picked the first time the kernels are asked for. SIMD kernels
+ * hand whatever doesn't fill a whole vector to the narrower ones.
+ */
+
+static inline uint8_t get_shade(uint8_t palette, uint8_t color_id) {
+    return (palette >> color_id * 2) & 0x03;
+}
+
+static void decode_tile_scalar(const uint8_t *tile, uint8_t (*rows)[8],
+                               uint8_t (*flipped_rows)[8]) {
+    for (uint8_t row = 0; row < 8; row++) {
+        const uint8_t low = tile[row * 2];
+        const uint8_t hi = tile[row * 2 + 1];
+        for (uint8_t pixel = 0; pixel < 8; pixel++) {
+            const uint8_t BIT = 7 - pixel;
+            const uint8_t color_id =
+                (uint8_t)(((hi >> BIT) & 1) << 1 | ((low >> BIT) & 1));
+            rows[row][pixel] = color_id;
+            flipped_rows[row][7 - pixel] = color_id;
+        }
+    }
+}
+
+static void map_palette_scalar(uint8_t *shades, const uint8_t *color_ids,
+                               uint8_t count, uint8_t palette) {
+    for (uint8_t i = 0; i < count; i++) {
+        shades[i] = get_shade(palette, color_ids[i] & 0x03);
+    }
+}
+
+static void merge_objects_scalar(uint8_t *shades, const uint8_t *object_pixels,
+                                 uint8_t count, uint8_t obp0, uint8_t obp1) {
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t object_pixel = object_pixels[i];
+        const uint8_t color_id = object_pixel & 0x03;
+        if (color_id == 0) {
+            continue;
+        }
+        const bool BEHIND = (object_pixel >> OBJ_PIXEL_PRIORITY_BIT) & 1;
+        if (!BEHIND || shades[i] == 0) {
+            const uint8_t palette =
+                (object_pixel >> OBJ_PIXEL_PALETTE_BIT) & 1 ? obp1 : obp0;
+            shades[i] = get_shade(palette, color_id);
+        }
+    }
+}
+
+// All channels of a shade are the same, white is 0xFFFFFFFF and black 0
+static void shades_to_rgba8888_scalar(uint32_t *colors, const uint8_t *shades,
+                                      uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        colors[i] = (uint32_t)(3 - shades[i]) * 0x55555555;
+    }
+}
+
+static const uint16_t RGB565_COLORS[4] = {0xFFFF, 0xAD55, 0x52AA, 0x0000};
+
+static void shades_to_rgb565_scalar(uint16_t *colors, const uint8_t *shades,
+                                    uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        colors[i] = RGB565_COLORS[shades[i] & 0x03];
+    }
+}
+
+static void shades_to_gray_scalar(uint8_t *grays, const uint8_t *shades,
+                                  uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        grays[i] = (uint8_t)((3 - shades[i]) * 0x55);
+    }
+}
+
+static const line_kernels_t SCALAR_KERNELS = {
+    &decode_tile_scalar,
+    &map_palette_scalar,
+    &merge_objects_scalar,
+    &shades_to_rgba8888_scalar,
+    &shades_to_rgb565_scalar,
+    &shades_to_gray_scalar,
+};
+
+#ifdef LINE_KERNELS_X86
+// SSE2 has no byte shuffle, so lookups into 4 entries use a compare each
+static inline __m128i lookup_sse2(__m128i indices, uint8_t v0, uint8_t v1,
+                                  uint8_t v2, uint8_t v3) {
+    const uint8_t VALUES[4] = {v0, v1, v2, v3};
+    __m128i result = _mm_setzero_si128();
+    for (uint8_t i = 0; i < 4; i++) {
+        const __m128i matches = _mm_cmpeq_epi8(indices, _mm_set1_epi8((char)i));
+        result = _mm_or_si128(
+            result, _mm_and_si128(matches, _mm_set1_epi8((char)VALUES[i])));
+    }
+    return result;
+}
+
+static inline __m128i lookup_palette_sse2(__m128i color_ids, uint8_t palette) {
+    return lookup_sse2(color_ids, get_shade(palette, 0), get_shade(palette, 1),
+                       get_shade(palette, 2), get_shade(palette, 3));
+}
+
+// Selects a where mask is set and b everywhere else
+static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void decode_tile_sse2(const uint8_t *tile, uint8_t (*rows)[8],
+                             uint8_t (*flipped_rows)[8]) {
+    // Pixel 0 is the top bit, two rows at a time
+    const __m128i BITS = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+                                      16, 32, 64, -128);
+    const __m128i FLIPPED_BITS = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1,
+                                              -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i ONE = _mm_set1_epi8(1);
+    const __m128i TWO = _mm_set1_epi8(2);
+    const uint64_t BROADCAST = 0x0101010101010101;
+    for (uint8_t row = 0; row < 8; row += 2) {
+        const __m128i low =
+            _mm_set_epi64x((long long)(tile[row * 2 + 2] * BROADCAST),
+                           (long long)(tile[row * 2] * BROADCAST));
+        const __m128i hi =
+            _mm_set_epi64x((long long)(tile[row * 2 + 3] * BROADCAST),
+                           (long long)(tile[row * 2 + 1] * BROADCAST));
+        __m128i low_set = _mm_cmpeq_epi8(_mm_and_si128(low, BITS), BITS);
+        __m128i hi_set = _mm_cmpeq_epi8(_mm_and_si128(hi, BITS), BITS);
+        _mm_storeu_si128((__m128i *)rows[row],
+                         _mm_or_si128(_mm_and_si128(low_set, ONE),
+                                      _mm_and_si128(hi_set, TWO)));
+        low_set =
+            _mm_cmpeq_epi8(_mm_and_si128(low, FLIPPED_BITS), FLIPPED_BITS);
+        hi_set = _mm_cmpeq_epi8(_mm_and_si128(hi, FLIPPED_BITS), FLIPPED_BITS);
+        _mm_storeu_si128((__m128i *)flipped_rows[row],
+                         _mm_or_si128(_mm_and_si128(low_set, ONE),
+                                      _mm_and_si128(hi_set, TWO)));
+    }
+}
+
+static void map_palette_sse2(uint8_t *shades, const uint8_t *color_ids,
+                             uint8_t count, uint8_t palette) {
+    const __m128i THREE = _mm_set1_epi8(3);
+    uint8_t i = 0;
+    for (; count - i >= 16; i += 16) {
+        const __m128i color_id = _mm_and_si128(
+            _mm_loadu_si128((const __m128i *)&color_ids[i]), THREE);
+        _mm_storeu_si128((__m128i *)&shades[i],
+                         lookup_palette_sse2(color_id, palette));
+    }
+    map_palette_scalar(&shades[i], &color_ids[i], (uint8_t)(count - i),
+                       palette);
+}
+
+static void merge_objects_sse2(uint8_t *shades, const uint8_t *object_pixels,
+                               uint8_t count, uint8_t obp0, uint8_t obp1) {
+    const __m128i ZERO = _mm_setzero_si128();
+    const __m128i THREE = _mm_set1_epi8(3);
+    const __m128i PALETTE_BIT = _mm_set1_epi8(1 << OBJ_PIXEL_PALETTE_BIT);
+    const __m128i PRIORITY_BIT = _mm_set1_epi8(-128);
+    uint8_t i = 0;
+    for (; count - i >= 16; i += 16) {
+        const __m128i object_pixel =
+            _mm_loadu_si128((const __m128i *)&object_pixels[i]);
+        const __m128i background = _mm_loadu_si128((const __m128i *)&shades[i]);
+        const __m128i color_id = _mm_and_si128(object_pixel, THREE);
+        const __m128i uses_obp1 = _mm_cmpeq_epi8(
+            _mm_and_si128(object_pixel, PALETTE_BIT), PALETTE_BIT);
+        const __m128i object_shade =
+            select_sse2(uses_obp1, lookup_palette_sse2(color_id, obp1),
+                        lookup_palette_sse2(color_id, obp0));
+        const __m128i behind = _mm_cmpeq_epi8(
+            _mm_and_si128(object_pixel, PRIORITY_BIT), PRIORITY_BIT);
+        const __m128i visible =
+            _mm_or_si128(_mm_xor_si128(behind, _mm_cmpeq_epi8(ZERO, ZERO)),
+                         _mm_cmpeq_epi8(background, ZERO));
+        const __m128i drawn =
+            _mm_andnot_si128(_mm_cmpeq_epi8(color_id, ZERO), visible);
+        _mm_storeu_si128((__m128i *)&shades[i],
+                         select_sse2(drawn, object_shade, background));
+    }
+    merge_objects_scalar(&shades[i], &object_pixels[i], (uint8_t)(count - i),
+                         obp0, obp1);
+}
+
+static void shades_to_rgba8888_sse2(uint32_t *colors, const uint8_t *shades,
+                                    uint8_t count) {
+    uint8_t i = 0;
+    for (; count - i >= 16; i += 16) {
+        const __m128i channel =
+            lookup_sse2(_mm_loadu_si128((const __m128i *)&shades[i]), 0xFF,
+                        0xAA, 0x55, 0x00);
+        const __m128i low = _mm_unpacklo_epi8(channel, channel);
+        const __m128i hi = _mm_unpackhi_epi8(channel, channel);
+        _mm_storeu_si128((__m128i *)&colors[i], _mm_unpacklo_epi16(low, low));
+        _mm_storeu_si128((__m128i *)&colors[i + 4],
+                         _mm_unpackhi_epi16(low, low));
+        _mm_storeu_si128((__m128i *)&colors[i + 8], _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i *)&colors[i + 12],
+                         _mm_unpackhi_epi16(hi, hi));
+    }
+    shades_to_rgba8888_scalar(&colors[i], &shades[i], (uint8_t)(count - i));
+}
+
+static void shades_to_rgb565_sse2(uint16_t *colors, const uint8_t *shades,
+                                  uint8_t count) {
+    uint8_t i = 0;
+    for (; count - i >= 16; i += 16) {
+        const __m128i shade = _mm_loadu_si128((const __m128i *)&shades[i]);
+        const __m128i low = lookup_sse2(shade, 0xFF, 0x55, 0xAA, 0x00);
+        const __m128i hi = lookup_sse2(shade, 0xFF, 0xAD, 0x52, 0x00);
+        _mm_storeu_si128((__m128i *)&colors[i], _mm_unpacklo_epi8(low, hi));
+        _mm_storeu_si128((__m128i *)&colors[i + 8], _mm_unpackhi_epi8(low, hi));
+    }
+    shades_to_rgb565_scalar(&colors[i], &shades[i], (uint8_t)(count - i));
+}
+
+static void shades_to_gray_sse2(uint8_t *grays, const uint8_t *shades,
+                                uint8_t count) {
+    uint8_t i = 0;
+    for (; count - i >= 16; i += 16) {
+        const __m128i shade = _mm_loadu_si128((const __m128i *)&shades[i]);
+        _mm_storeu_si128((__m128i *)&grays[i],
+                         lookup_sse2(shade, 0xFF, 0xAA, 0x55, 0x00));
+    }
+    shades_to_gray_scalar(&grays[i], &shades[i], (uint8_t)(count - i));
+}
+
+static const line_kernels_t SSE2_KERNELS = {
+    &decode_tile_sse2,
+    &map_palette_sse2,
+    &merge_objects_sse2,
+    &shades_to_rgba8888_sse2,
+    &shades_to_rgb565_sse2,
+    &shades_to_gray_sse2,
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+// Lookups into 4 entries are a byte shuffle with the table in every dword
+AVX2 static inline __m256i lookup_avx2(__m256i indices, uint8_t v0, uint8_t v1,
+                                       uint8_t v2, uint8_t v3) {
+    const __m256i TABLE = _mm256_set1_epi32(
+        (int)((uint32_t)v0 | (uint32_t)v1 << 8 | (uint32_t)v2 << 16 |
+              (uint32_t)v3 << 24));
+    return _mm256_shuffle_epi8(TABLE, indices);
+}
+
+AVX2 static inline __m256i lookup_palette_avx2(__m256i color_ids,
+                                               uint8_t palette) {
+    return lookup_avx2(color_ids, get_shade(palette, 0), get_shade(palette, 1),
+                       get_shade(palette, 2), get_shade(palette, 3));
+}
+
+AVX2 static void map_palette_avx2(uint8_t *shades, const uint8_t *color_ids,
+                                  uint8_t count, uint8_t palette) {
+    const __m256i THREE = _mm256_set1_epi8(3);
+    uint8_t i = 0;
+    for (; count - i >= 32; i += 32) {
+        const __m256i color_id = _mm256_and_si256(
+            _mm256_loadu_si256((const __m256i *)&color_ids[i]), THREE);
+        _mm256_storeu_si256((__m256i *)&shades[i],
+                            lookup_palette_avx2(color_id, palette));
+    }
+    map_palette_sse2(&shades[i], &color_ids[i], (uint8_t)(count - i), palette);
+}
+
+AVX2 static void merge_objects_avx2(uint8_t *shades,
+                                    const uint8_t *object_pixels,
+                                    uint8_t count, uint8_t obp0,
+                                    uint8_t obp1) {
+    const __m256i ZERO = _mm256_setzero_si256();
+    const __m256i THREE = _mm256_set1_epi8(3);
+    const __m256i PALETTE_BIT = _mm256_set1_epi8(1 << OBJ_PIXEL_PALETTE_BIT);
+    uint8_t i = 0;
+    for (; count - i >= 32; i += 32) {
+        const __m256i object_pixel =
+            _mm256_loadu_si256((const __m256i *)&object_pixels[i]);
+        const __m256i background =
+            _mm256_loadu_si256((const __m256i *)&shades[i]);
+        const __m256i color_id = _mm256_and_si256(object_pixel, THREE);
+        const __m256i uses_obp1 = _mm256_cmpeq_epi8(
+            _mm256_and_si256(object_pixel, PALETTE_BIT), PALETTE_BIT);
+        const __m256i object_shade = _mm256_blendv_epi8(
+            lookup_palette_avx2(color_id, obp0),
+            lookup_palette_avx2(color_id, obp1), uses_obp1);
+        // The priority bit is the sign bit, which is all blendv looks at
+        const __m256i hidden = _mm256_andnot_si256(
+            _mm256_cmpeq_epi8(background, ZERO), object_pixel);
+        const __m256i drawn = _mm256_andnot_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(color_id, ZERO), hidden),
+            _mm256_cmpeq_epi8(ZERO, ZERO));
+        _mm256_storeu_si256(
+            (__m256i *)&shades[i],
+            _mm256_blendv_epi8(background, object_shade, drawn));
+    }
+    merge_objects_sse2(&shades[i], &object_pixels[i], (uint8_t)(count - i),
+                       obp0, obp1);
+}
+
+AVX2 static void shades_to_rgba8888_avx2(uint32_t *colors,
+                                         const uint8_t *shades, uint8_t count) {
+    const __m128i CHANNELS = _mm_set1_epi32((int)0x0055AAFF);
+    const __m256i BROADCAST = _mm256_set1_epi32(0x01010101);
+    uint8_t i = 0;
+    for (; count - i >= 8; i += 8) {
+        const __m128i channel = _mm_shuffle_epi8(
+            CHANNELS, _mm_loadl_epi64((const __m128i *)&shades[i]));
+        _mm256_storeu_si256(
+            (__m256i *)&colors[i],
+            _mm256_mullo_epi32(_mm256_cvtepu8_epi32(channel), BROADCAST));
+    }
+    shades_to_rgba8888_scalar(&colors[i], &shades[i], (uint8_t)(count - i));
+}
+
+AVX2 static void shades_to_gray_avx2(uint8_t *grays, const uint8_t *shades,
+                                     uint8_t count) {
+    uint8_t i = 0;
+    for (; count - i >= 32; i += 32) {
+        const __m256i shade =
+            _mm256_loadu_si256((const __m256i *)&shades[i]);
+        _mm256_storeu_si256((__m256i *)&grays[i],
+                            lookup_avx2(shade, 0xFF, 0xAA, 0x55, 0x00));
+    }
+    shades_to_gray_sse2(&grays[i], &shades[i], (uint8_t)(count - i));
+}
+
+static const line_kernels_t AVX2_KERNELS = {
+    &decode_tile_sse2,
+    &map_palette_avx2,
+    &merge_objects_avx2,
+    &shades_to_rgba8888_avx2,
+    &shades_to_rgb565_sse2,
+    &shades_to_gray_avx2,
+};
+#endif
+
+static const line_kernels_t *line_kernels = &SCALAR_KERNELS;
+static pthread_once_t line_kernels_selected = PTHREAD_ONCE_INIT;
+
+static void select_line_kernels(void) {
+#ifdef LINE_KERNELS_X86
+    __builtin_cpu_init();
+    line_kernels =
+        __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : &SSE2_KERNELS;
+#endif
+}
+
+const line_kernels_t *get_line_kernels(void) {
+    pthread_once(&line_kernels_selected, &select_line_kernels);
+    return line_kernels;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+// Object pixels of a line: color ID in bits 0-1, 0 where no object is drawn
+#define OBJ_PIXEL_PALETTE_BIT 4
+#define OBJ_PIXEL_PRIORITY_BIT 7
+
+/*
+ * Kernels the scanline renderer draws a run of pixels with. Shades are the
+ * palette values 0 (white) to 3 (black).
+ */
+typedef struct LineKernels {
+    // 16 bytes of tile data into 8 rows of color IDs, and the same mirrored
+    void (*decode_tile)(const uint8_t *tile, uint8_t (*rows)[8],
+                        uint8_t (*flipped_rows)[8]);
+    void (*map_palette)(uint8_t *shades, const uint8_t *color_ids,
+                        uint8_t count, uint8_t palette);
+    // Draws object pixels over the background, or behind it where it's white
+    void (*merge_objects)(uint8_t *shades, const uint8_t *object_pixels,
+                          uint8_t count, uint8_t obp0, uint8_t obp1);
+    // Frame conversion, white is 0xFFFFFFFF in RGBA8888 and black 0
+    void (*shades_to_rgba8888)(uint32_t *colors, const uint8_t *shades,
+                               uint8_t count);
+    void (*shades_to_rgb565)(uint16_t *colors, const uint8_t *shades,
+                             uint8_t count);
+    void (*shades_to_gray)(uint8_t *grays, const uint8_t *shades,
+                           uint8_t count);
+} line_kernels_t;
+
+const line_kernels_t *get_line_kernels(void);
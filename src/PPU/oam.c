@@ -1,34 +1,55 @@
 #include "hardware.h"
+#include "context.h"
+#include "line_kernels.h"
 #include "memory.h"
 #include "oam_queue.h"
+#include "ppu.h"
+#include "scheduler.h"
+#include "tile_cache.h"
 #include "utils.h"
 #include <string.h>
 
-SpriteStore sprite_store;
-
 void initialize_sprite_store(void) {
-    sprite_store.length = 0;
-    memset(sprite_store.selected_objects, 0,
+    gb->sprite_store.length = 0;
+    memset(gb->sprite_store.selected_objects, 0,
            MAX_OBJECTS * sizeof(struct ObjectRowData));
+    memset(gb->sprite_store.object_line, 0, DISPLAY_WIDTH);
     return;
 }
 
-SpriteStore *get_sprite_store(void) { return &sprite_store; }
+SpriteStore *get_sprite_store(void) { return &gb->sprite_store; }
+
+/*
+ * Started by a write to DMA. The CPU keeps running but can only reach the IO
+ * registers and HRAM until the transfer is done, so nothing can tell the 160
+ * bytes apart from being copied all at once at the end.
+ */
+void start_oam_dma_transfer(void) {
+    set_oam_dma_transfer(true);
+    set_memory_bus_blocked(true);
+    schedule_event(OAM_DMA_EVENT, get_cycles() + OAM_SIZE * FOUR_CLOCKS);
+}
 
-clock_cycles_t try_oam_dma_transfer(void) {
-    static uint8_t current_oam_byte = 0;
-    if (current_oam_byte == OAM_SIZE) {
-        current_oam_byte %= OAM_SIZE;
-        set_oam_dma_transfer(false);
+void handle_oam_dma_event(void) {
+    // The lines drawn during the transfer still used the old objects
+    catch_up_ppu();
+    set_oam_dma_transfer(false);
+    set_memory_bus_blocked(false);
+    const uint8_t PAGE = privileged_get_memory_byte(DMA);
+    const uint8_t *source = get_oam_dma_source(PAGE);
+    if (source) {
+        memcpy(gb->memory.oam, source, OAM_SIZE);
+    } else {
+        for (uint16_t offset = 0; offset < OAM_SIZE; offset++) {
+            gb->memory.oam[offset] =
+                get_memory_byte((uint16_t)((PAGE << 8) + offset));
+        }
     }
-    if (!get_oam_dma_transfer()) {
-        return 0;
+    if (gb->ppu.render_worker) {
+        for (uint16_t offset = 0; offset < OAM_SIZE; offset++) {
+            log_render_write(OAM_START + offset, gb->memory.oam[offset]);
+        }
     }
-    uint16_t start = (uint16_t)(privileged_get_memory_byte(DMA) << 8);
-    privileged_set_memory_byte(OAM_START + current_oam_byte,
-                               privileged_get_memory_byte(start + current_oam_byte));
-    current_oam_byte++;
-    return FOUR_CLOCKS;
 }
 
 typedef struct Object {
@@ -55,12 +76,12 @@ uint16_t get_tile_row_address(uint8_t tile_index) {
 }
 
 void add_sprite(uint16_t object_no) {
-    if (sprite_store.length == MAX_OBJECTS) {
+    if (gb->sprite_store.length == MAX_OBJECTS) {
         return;
     }
     object_t obj = get_object(object_no);
-    uint8_t obj_h = get_bit(privileged_get_memory_byte(LCDC), 2) ? 16 : 8;
-    uint16_t current_draw_height = privileged_get_memory_byte(LCDY) + 16;
+    uint8_t obj_h = gb->ppu.registers.object_height;
+    uint16_t current_draw_height = gb->ppu.current_scan_line + 16;
 
     if (obj.y_pos > current_draw_height ||
         current_draw_height >= obj.y_pos + obj_h) {
@@ -82,18 +103,67 @@ void add_sprite(uint16_t object_no) {
     } else {
         tile_index = obj.tile_index;
     }
-    sprite_store.selected_objects[sprite_store.length].x_start = obj.x_pos;
-    sprite_store.selected_objects[sprite_store.length].tile_start =
-        get_tile_row_address(tile_index);
-    sprite_store.selected_objects[sprite_store.length].y =
-        privileged_get_memory_byte(LCDY) - obj.y_pos % obj_h;
-    sprite_store.selected_objects[sprite_store.length].x_flipped =
-        get_bit(obj.attribute_flags, 5);
-    sprite_store.selected_objects[sprite_store.length].y_flipped = y_flipped;
-    sprite_store.selected_objects[sprite_store.length].DMG_palette =
-        get_bit(obj.attribute_flags, 4);
-    sprite_store.selected_objects[sprite_store.length].priority =
-        get_bit(obj.attribute_flags, 7);
-    sprite_store.length++;
+    SpriteStore *sprite_store = &gb->sprite_store;
+    struct ObjectRowData *selected =
+        &sprite_store->selected_objects[sprite_store->length];
+    selected->x_start = obj.x_pos;
+    selected->tile_start = get_tile_row_address(tile_index);
+    selected->y = gb->ppu.current_scan_line - obj.y_pos % obj_h;
+    selected->x_flipped = get_bit(obj.attribute_flags, 5);
+    selected->y_flipped = y_flipped;
+    selected->DMG_palette = get_bit(obj.attribute_flags, 4);
+    selected->priority = get_bit(obj.attribute_flags, 7);
+    sprite_store->length++;
     return;
 }
+
+/*
+ * Draws the selected objects into the object line. Where objects overlap the
+ * one with the smaller X wins, then the one earlier in OAM, and an object only
+ * covers another where its pixel isn't transparent.
+ */
+void build_object_line(void) {
+    SpriteStore *sprite_store = &gb->sprite_store;
+    uint8_t *line = sprite_store->object_line;
+    memset(line, 0, DISPLAY_WIDTH);
+
+    // Insertion sort by X, stable so OAM order breaks ties
+    uint8_t order[MAX_OBJECTS];
+    for (uint8_t i = 0; i < sprite_store->length; i++) {
+        const uint8_t x_start = sprite_store->selected_objects[i].x_start;
+        uint8_t j = i;
+        while (j > 0 &&
+               sprite_store->selected_objects[order[j - 1]].x_start > x_start) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    for (uint8_t i = 0; i < sprite_store->length; i++) {
+        const struct ObjectRowData obj =
+            sprite_store->selected_objects[order[i]];
+        const int32_t first = obj.x_start - 8 > 0 ? obj.x_start - 8 : 0;
+        const int32_t last =
+            obj.x_start < DISPLAY_WIDTH ? obj.x_start : DISPLAY_WIDTH;
+        if (first >= last) {
+            continue;
+        }
+
+        uint8_t row = obj.y % 8;
+        if (obj.y_flipped) {
+            row = 7 - row;
+        }
+        const uint8_t *tile_row =
+            get_tile_row(obj.tile_start, row, obj.x_flipped);
+        const uint8_t attributes =
+            (uint8_t)((obj.DMG_palette & 1) << OBJ_PIXEL_PALETTE_BIT |
+                      (obj.priority & 1) << OBJ_PIXEL_PRIORITY_BIT);
+        for (int32_t x = first; x < last; x++) {
+            const uint8_t color_id = tile_row[x - (obj.x_start - 8)];
+            if (line[x] == 0 && color_id != 0) {
+                line[x] = color_id | attributes;
+            }
+        }
+    }
+}
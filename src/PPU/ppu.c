@@ -1,24 +1,26 @@
 #include "ppu.h"
+#include "context.h"
 #include "cpu.h"
 #include "hardware.h"
 #include "interrupts.h"
+#include "line_kernels.h"
 #include "memory.h"
 #include "oam_queue.h"
 #include "ppu_utils.h"
+#include "render_worker.h"
+#include "scheduler.h"
+#include "tile_cache.h"
 #include "utils.h"
-#include <ncurses.h>
-#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define DOTS_PER_LINE 456
-
-PPU ppu;
-
-static bool close_ppu;
-pthread_mutex_t dots_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t display_buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Adaptive frame skip never draws less than one frame in MAX_FRAME_SKIP
+#define MAX_FRAME_SKIP 4
+// On time frames in a row before the adaptive frame skip draws more again
+#define FRAMES_ON_TIME_TO_RECOVER 60
 
 static bool execute_mode_0(void);
 static bool execute_mode_1(void);
@@ -29,169 +31,428 @@ static void increase_scan_line(void);
 static void set_ppu_mode(uint8_t mode);
 
 void initialize_ppu(void) {
-    close_ppu = false;
-    ppu.line_dots = 0;
-    ppu.mode = 2;
-    ppu.ready_to_render = false;
-    ppu.available_dots = 0;
-    ppu.consumed_dots = 0;
-    ppu.current_scan_line = 0;
-    ppu.window_rendered = false;
-    ppu.current_window_line = 0;
-    ppu.line_x = 0;
-}
-
-void *start_ppu(void *arg) {
-    (void)arg;
-    render_loop();
-    return NULL;
-}
-
-void render_loop(void) {
-    while (close_ppu == false) {
-        switch (ppu.mode) {
-            case 0: execute_mode_0(); break;
-            case 1: execute_mode_1(); break;
-            case 2: execute_mode_2(); break;
-            case 3: execute_mode_3(); break;
-            default: exit(1);
-        }
-    }
-}
-
-bool (*get_current_mode_func(void))(void) {
-    switch (ppu.mode) {
-        case 0: return execute_mode_0; break;
-        case 1: return execute_mode_1; break;
-        case 2: return execute_mode_2; break;
-        case 3: return execute_mode_3; break;
+    gb->ppu.line_dots = 0;
+    gb->ppu.mode = 2;
+    gb->ppu.ready_to_render = false;
+    gb->ppu.available_dots = 0;
+    gb->ppu.consumed_dots = 0;
+    gb->ppu.current_scan_line = 0;
+    gb->ppu.window_rendered = false;
+    gb->ppu.current_window_line = 0;
+    gb->ppu.line_x = 0;
+    gb->ppu.frame_skip = 1;
+    gb->ppu.frames_until_drawn = 0;
+    gb->ppu.skipping_frame = false;
+    gb->ppu.adaptive_frame_skip = false;
+    gb->ppu.frames_on_time = 0;
+    initialize_ppu_registers();
+    initialize_tile_cache();
+}
+
+/*
+ * Runs the current mode as far as the available dots go, without crossing
+ * into the next mode. Returns false once it can't make any progress.
+ */
+static bool execute_mode(void) {
+    switch (gb->ppu.mode) {
+        case 0: return execute_mode_0();
+        case 1: return execute_mode_1();
+        case 2: return execute_mode_2();
+        case 3: return execute_mode_3();
         default: exit(1);
     }
 }
 
-void run_ppu(uint16_t dots) {
-    bool executed;
-    if (!get_bit(privileged_get_memory_byte(LCDC), 7)) {
-        return;
+/*
+ * Needed whenever LY changes and whenever LYC or STAT may have been written,
+ * which always syncs the PPU. STAT itself is only written when the
+ * coincidence flag changes.
+ */
+static void update_lyc_coincidence(void) {
+    PPURegisters *registers = &gb->ppu.registers;
+    const bool COINCIDENCE = registers->lyc == gb->ppu.current_scan_line;
+    if (COINCIDENCE) {
+        trigger_stat_source(LYC_INT);
+    } else {
+        clear_stat_source(LYC_INT);
     }
-    ppu.available_dots += dots;
-    do {
+    if (COINCIDENCE != registers->lyc_coincidence) {
         uint8_t lcd_status = privileged_get_memory_byte(STAT);
-        if (privileged_get_memory_byte(LYC) == privileged_get_memory_byte(LCDY)) {
+        if (COINCIDENCE) {
             set_bit(&lcd_status, 2);
-            privileged_set_memory_byte(STAT, lcd_status);
-            trigger_stat_source(LYC_INT);
         } else {
             reset_bit(&lcd_status, 2);
-            privileged_set_memory_byte(STAT, lcd_status);
-            clear_stat_source(LYC_INT);
         }
-        bool (*current_mode_func)(void) = get_current_mode_func();
-        executed = current_mode_func();
+        privileged_set_memory_byte(STAT, lcd_status);
+    }
+}
+
+void run_ppu(uint32_t dots) {
+    bool executed;
+    if (!get_bit(gb->ppu.registers.lcdc, 7)) {
+        return;
+    }
+    gb->ppu.available_dots += dots;
+    update_lyc_coincidence();
+    do {
+        const uint8_t LINE = gb->ppu.current_scan_line;
+        executed = execute_mode();
+        if (gb->ppu.current_scan_line != LINE) {
+            update_lyc_coincidence();
+        }
     } while (executed == true);
 }
 
+/*
+ * Runs the PPU up to the current cycle. Only has to be done before the CPU
+ * looks at or changes something the PPU works with: VRAM, OAM, STAT, LY and
+ * the registers it draws with. Everything else it does in between is only
+ * seen through its interrupts, which are scheduled as events.
+ */
+void catch_up_ppu(void) {
+    const uint64_t NOW = get_cycles();
+    const uint64_t DOTS = NOW - gb->ppu.synced_at;
+    if (DOTS == 0) {
+        return;
+    }
+    gb->ppu.synced_at = NOW;
+    if (!get_bit(gb->ppu.registers.lcdc, 7)) {
+        return;
+    }
+    run_ppu((uint32_t)DOTS);
+}
+
+static uint32_t dots_left(uint32_t done, uint32_t total) {
+    return done < total ? total - done : 0;
+}
+
+/*
+ * Lower bound on the dots left before the PPU next changes anything the CPU
+ * can see: a mode change, LY or an interrupt. Everything in between only
+ * draws pixels.
+ */
+static uint32_t dots_until_visible_change(void) {
+    switch (gb->ppu.mode) {
+        case 2: return dots_left(gb->ppu.line_dots, 80);
+        case 3: return dots_left(gb->ppu.line_x, DISPLAY_WIDTH);
+        case 0:
+        case 1:
+        default: return dots_left(gb->ppu.line_dots, DOTS_PER_LINE);
+    }
+}
+
+/*
+ * Lower bound on the dots left before the PPU may next raise an interrupt.
+ * VBlank is always raised at the start of line 144, and every enabled STAT
+ * source but mode 0 can only fire at the start of a line.
+ */
+static uint32_t dots_until_interrupt(void) {
+    const uint8_t LINE = gb->ppu.current_scan_line;
+    const uint8_t STAT_SELECTS = gb->ppu.registers.stat_selects;
+    const uint32_t LINE_END = dots_left(gb->ppu.line_dots, DOTS_PER_LINE);
+    const uint32_t LINES_TO_VBLANK =
+        LINE < DISPLAY_HEIGHT ? DISPLAY_HEIGHT - 1u - LINE
+                              : SCAN_LINES - 1u - LINE + DISPLAY_HEIGHT;
+    uint32_t dots = LINE_END + LINES_TO_VBLANK * DOTS_PER_LINE;
+    if (STAT_SELECTS & ((1 << MODE_2_INT) | (1 << LYC_INT))) {
+        dots = LINE_END;
+    }
+    if (STAT_SELECTS & (1 << MODE_0_INT)) {
+        const bool DRAWING =
+            LINE < DISPLAY_HEIGHT && (gb->ppu.mode == 2 || gb->ppu.mode == 3);
+        const uint32_t MODE_0_START =
+            DRAWING ? dots_until_visible_change() : LINE_END;
+        if (MODE_0_START < dots) {
+            dots = MODE_0_START;
+        }
+    }
+    return dots;
+}
+
+static void schedule_ppu(void) {
+    if (!get_bit(gb->ppu.registers.lcdc, 7)) {
+        cancel_event(PPU_EVENT);
+        return;
+    }
+    uint64_t dots = 1;
+    if (dots_until_interrupt() > gb->ppu.available_dots) {
+        dots = dots_until_interrupt() - gb->ppu.available_dots;
+    }
+    schedule_event(PPU_EVENT, gb->ppu.synced_at + dots);
+}
+
+/*
+ * Runs the PPU up to the current cycle before something it depends on is
+ * changed and has it look at the new state after the current instruction.
+ */
+void sync_ppu(void) {
+    catch_up_ppu();
+    schedule_event(PPU_EVENT, get_cycles() + 1);
+}
+
+void handle_ppu_event(void) {
+    catch_up_ppu();
+    schedule_ppu();
+}
+
+/*
+ * First cycle the CPU could see the PPU change anything at, for code that
+ * assumes nothing changes while it only reads. UINT64_MAX while the LCD is
+ * off.
+ */
+uint64_t get_next_ppu_change_cycle(void) {
+    catch_up_ppu();
+    if (!get_bit(gb->ppu.registers.lcdc, 7)) {
+        return UINT64_MAX;
+    }
+    uint64_t dots = 1;
+    if (dots_until_visible_change() > gb->ppu.available_dots) {
+        dots = dots_until_visible_change() - gb->ppu.available_dots;
+    }
+    return gb->ppu.synced_at + dots;
+}
+
+// First cycle LY could read differently at, UINT64_MAX while the LCD is off
+uint64_t get_next_line_cycle(void) {
+    catch_up_ppu();
+    if (!get_bit(gb->ppu.registers.lcdc, 7)) {
+        return UINT64_MAX;
+    }
+    const uint32_t LINE_END = dots_left(gb->ppu.line_dots, DOTS_PER_LINE);
+    uint64_t dots = 1;
+    if (LINE_END > gb->ppu.available_dots) {
+        dots = LINE_END - gb->ppu.available_dots;
+    }
+    return gb->ppu.synced_at + dots;
+}
+
 bool consume_dots(uint64_t dots_to_consume) {
-    if (ppu.available_dots < dots_to_consume) {
+    if (gb->ppu.available_dots < dots_to_consume) {
         return false;
     }
-    ppu.available_dots -= dots_to_consume;
-    ppu.consumed_dots += dots_to_consume;
-    ppu.line_dots += dots_to_consume;
+    gb->ppu.available_dots -= dots_to_consume;
+    gb->ppu.consumed_dots += dots_to_consume;
+    gb->ppu.line_dots += dots_to_consume;
     return true;
 }
 
-static bool window_enabled = false;
+/*
+ * OAM scan checks an object every 2 dots. Scans as many as the available dots
+ * pay for at once, OAM and the registers it depends on can't change in
+ * between without syncing the PPU first.
+ */
 static bool execute_mode_2(void) {
-    // wait for 2 dots
-    static uint8_t object_index = 0;
-    if (!consume_dots(2)) {
+    uint32_t objects = dots_left(gb->ppu.line_dots, 80) / 2;
+    if (objects > gb->ppu.available_dots / 2) {
+        objects = gb->ppu.available_dots / 2;
+    }
+    if (objects == 0 || !consume_dots(objects * 2)) {
         return false;
     }
-    add_sprite(object_index++);
-    const uint8_t wy = privileged_get_memory_byte(WY);
-    if (wy == ppu.current_scan_line) {
-        window_enabled = true;
+    if (gb->ppu.render_worker) {
+        if (!gb->ppu.skipping_frame) {
+            log_object_scan(gb->ppu.object_index,
+                            (uint8_t)(gb->ppu.object_index + objects));
+        }
+        gb->ppu.object_index += (uint8_t)objects;
+    } else {
+        for (uint32_t i = 0; i < objects; i++) {
+            add_sprite(gb->ppu.object_index++);
+        }
+    }
+    if (gb->ppu.registers.wy == gb->ppu.current_scan_line) {
+        gb->ppu.window_enabled = true;
     }
-    if (ppu.line_dots >= 80) {
+    if (gb->ppu.line_dots >= 80) {
         // Setup for Mode 3
+        if (gb->ppu.render_worker && !gb->ppu.skipping_frame) {
+            log_object_line();
+        } else if (!gb->ppu.skipping_frame) {
+            build_object_line();
+        }
         set_ppu_mode(3);
-        object_index = 0;
-        ppu.line_x = 0;
+        gb->ppu.object_index = 0;
+        gb->ppu.line_x = 0;
     }
     return true;
 }
 
-static bool execute_mode_3(void) {
-    uint16_t penalty_dots = 0;
-    if (ppu.line_x == 0) {
-        penalty_dots += privileged_get_memory_byte(SCX) % 8;
-    }
-    if (ppu.line_x == privileged_get_memory_byte(WX) - 7) {
-        penalty_dots += 6;
-    }
-    // wait an extra dot for the pixel;
-    if (!consume_dots(penalty_dots + 1)) {
-        return false;
-    }
+static void draw_pixel(void) {
+    const PPURegisters *registers = &gb->ppu.registers;
     uint8_t pixel = 0;
-    if (get_bit(privileged_get_memory_byte(LCDC), 0)) {
-        pixel = get_bg_pixel(ppu.line_x, ppu.current_scan_line);
-        const uint8_t wx = privileged_get_memory_byte(WX);
-        if (get_bit(privileged_get_memory_byte(LCDC), 5) && ppu.line_x >= (wx - 7) &&
-            window_enabled) {
-            pixel = get_win_pixel(ppu.line_x, ppu.current_window_line);
-            ppu.window_rendered = true;
+    if (get_bit(registers->lcdc, 0)) {
+        pixel = get_bg_pixel(gb->ppu.line_x, gb->ppu.current_scan_line);
+        if (get_bit(registers->lcdc, 5) &&
+            gb->ppu.line_x >= (registers->wx - 7) && gb->ppu.window_enabled) {
+            pixel = get_win_pixel(gb->ppu.line_x, gb->ppu.current_window_line);
+            gb->ppu.window_rendered = true;
         }
     }
 
-    const uint8_t object_pixel = get_obj_pixel(ppu.line_x);
+    const uint8_t object_pixel = get_obj_pixel(gb->ppu.line_x);
     if (object_pixel != TRANSPARENT) {
         if (!get_bit(object_pixel, 7) || pixel == 0) {
             pixel = object_pixel & 0x03;
         }
     }
 
-    pthread_mutex_lock(&display_buffer_mutex);
-    set_display_pixel(ppu.line_x, ppu.current_scan_line,
-                      get_color_from_byte(pixel));
-    pthread_mutex_unlock(&display_buffer_mutex);
+    set_display_pixel(gb->ppu.line_x, gb->ppu.current_scan_line, pixel);
+}
+
+/*
+ * Draws pixels x_start up to x_end of the current line in one pass. Gives the
+ * same result as drawing them one at a time since every register the pixels
+ * depend on syncs the PPU before it is written.
+ */
+static void draw_line(uint8_t x_start, uint8_t x_end) {
+    const line_kernels_t *kernels = get_line_kernels();
+    const uint8_t COUNT = x_end - x_start;
+    uint8_t color_ids[DISPLAY_WIDTH];
+    // The frame holds shades, so the line is drawn in place
+    uint8_t *shades =
+        get_display_buffer() + gb->ppu.current_scan_line * DISPLAY_WIDTH;
+    const PPURegisters *registers = &gb->ppu.registers;
+    if (get_bit(registers->lcdc, 0)) {
+        get_bg_line(color_ids, x_start, x_end, gb->ppu.current_scan_line);
+        const int32_t window_x = registers->wx - 7;
+        if (get_bit(registers->lcdc, 5) && gb->ppu.window_enabled &&
+            window_x < x_end) {
+            const uint8_t window_start =
+                window_x > x_start ? (uint8_t)window_x : x_start;
+            get_win_line(color_ids, window_start, x_end,
+                         gb->ppu.current_window_line);
+            gb->ppu.window_rendered = true;
+        }
+        kernels->map_palette(&shades[x_start], &color_ids[x_start], COUNT,
+                             registers->bgp);
+    } else {
+        memset(&shades[x_start], WHITE, COUNT);
+    }
+    if (get_bit(registers->lcdc, 1)) {
+        const uint8_t *object_line = get_sprite_store()->object_line;
+        kernels->merge_objects(&shades[x_start], &object_line[x_start], COUNT,
+                               registers->obp0, registers->obp1);
+    }
+}
+
+// Pixels x_start up to x_end of the current line, which starts at line_x
+void draw_pixels(uint8_t x_start, uint8_t x_end) {
+    if (gb->ppu.renderer == PIXEL_RENDERER) {
+        draw_pixel();
+    } else {
+        draw_line(x_start, x_end);
+    }
+}
+
+/*
+ * Mode 3 takes a dot per pixel, plus the SCX fine scroll discarded before the
+ * first pixel and 6 dots for fetching the window where it starts. Draws every
+ * pixel the available dots pay for at once, or only one with the pixel
+ * renderer.
+ */
+static bool execute_mode_3(void) {
+    const uint8_t X_START = gb->ppu.line_x;
+    const uint8_t MAX_PIXELS =
+        gb->ppu.renderer == PIXEL_RENDERER ? 1 : DISPLAY_WIDTH;
+    const uint8_t FINE_SCROLL = gb->ppu.registers.scx % 8;
+    const int32_t WINDOW_X = gb->ppu.registers.wx - 7;
+    uint32_t dots = 0;
+    uint8_t x_end = X_START;
+    while (x_end < DISPLAY_WIDTH && x_end - X_START < MAX_PIXELS) {
+        uint32_t pixel_dots = 1;
+        if (x_end == 0) {
+            pixel_dots += FINE_SCROLL;
+        }
+        if (x_end == WINDOW_X) {
+            pixel_dots += 6;
+        }
+        if (dots + pixel_dots > gb->ppu.available_dots) {
+            break;
+        }
+        dots += pixel_dots;
+        x_end++;
+    }
+    if (x_end == X_START || !consume_dots(dots)) {
+        return false;
+    }
+    if (gb->ppu.skipping_frame || gb->ppu.render_worker) {
+        // Drawn by the render worker or not at all, but the window still
+        // counts the lines it covers
+        const PPURegisters *registers = &gb->ppu.registers;
+        if (get_bit(registers->lcdc, 0) && get_bit(registers->lcdc, 5) &&
+            gb->ppu.window_enabled && WINDOW_X < x_end) {
+            gb->ppu.window_rendered = true;
+        }
+        if (!gb->ppu.skipping_frame) {
+            log_pixels(X_START, x_end);
+        }
+    } else {
+        draw_pixels(X_START, x_end);
+    }
 
-    if (++ppu.line_x >= DISPLAY_WIDTH) {
+    gb->ppu.line_x = x_end;
+    if (gb->ppu.line_x >= DISPLAY_WIDTH) {
         set_ppu_mode(0);
     }
     return true;
 }
 
+// Consumes the dots up to the end of the line, or as many as are available
+static bool advance_to_line_end(void) {
+    uint32_t dots = dots_left(gb->ppu.line_dots, DOTS_PER_LINE);
+    if (dots > gb->ppu.available_dots) {
+        dots = gb->ppu.available_dots;
+    }
+    return dots > 0 && consume_dots(dots);
+}
+
 static bool execute_mode_0(void) {
-    if (!consume_dots(1)) {
+    if (!advance_to_line_end()) {
         return false;
     }
-    if (ppu.line_dots >= DOTS_PER_LINE) {
+    if (gb->ppu.line_dots >= DOTS_PER_LINE) {
         increase_scan_line();
-        if (ppu.current_scan_line >= DISPLAY_HEIGHT) {
-            ppu.ready_to_render = true;
+        if (gb->ppu.current_scan_line >= DISPLAY_HEIGHT) {
+            // A skipped frame leaves the last drawn one on screen
+            if (gb->ppu.render_worker && !gb->ppu.skipping_frame) {
+                log_frame_end();
+            } else if (!gb->ppu.skipping_frame) {
+                publish_display_buffer();
+            }
+            gb->ppu.ready_to_render = true;
             set_interrupts_flag(VBLANK);
             set_ppu_mode(1);
         } else {
             set_ppu_mode(2);
             initialize_sprite_store();
         }
-        ppu.line_dots %= DOTS_PER_LINE;
+        gb->ppu.line_dots %= DOTS_PER_LINE;
     }
     return true;
 }
 
+// Decides whether the frame starting now is drawn or skipped
+static void start_frame(void) {
+    if (gb->ppu.frames_until_drawn > 0) {
+        gb->ppu.frames_until_drawn--;
+        gb->ppu.skipping_frame = true;
+    } else {
+        gb->ppu.frames_until_drawn = gb->ppu.frame_skip - 1;
+        gb->ppu.skipping_frame = false;
+    }
+}
+
 static bool execute_mode_1(void) {
-    if (!consume_dots(1)) {
+    if (!advance_to_line_end()) {
         return false;
     }
-    if (ppu.line_dots >= 456) {
+    if (gb->ppu.line_dots >= DOTS_PER_LINE) {
         increase_scan_line();
-        ppu.line_dots %= 456;
-        if (ppu.current_scan_line == 0) {
-            ppu.current_window_line = 0;
-            window_enabled = false;
+        gb->ppu.line_dots %= DOTS_PER_LINE;
+        if (gb->ppu.current_scan_line == 0) {
+            start_frame();
+            gb->ppu.current_window_line = 0;
+            gb->ppu.window_enabled = false;
             initialize_sprite_store();
             set_ppu_mode(2);
         }
@@ -200,12 +461,12 @@ static bool execute_mode_1(void) {
 }
 
 static void increase_scan_line(void) {
-    ppu.current_scan_line += 1;
-    ppu.current_scan_line %= SCAN_LINES;
-    privileged_set_memory_byte(LCDY, ppu.current_scan_line);
-    if (ppu.window_rendered == true) {
-        ppu.current_window_line++;
-        ppu.window_rendered = false;
+    gb->ppu.current_scan_line += 1;
+    gb->ppu.current_scan_line %= SCAN_LINES;
+    privileged_set_memory_byte(LCDY, gb->ppu.current_scan_line);
+    if (gb->ppu.window_rendered == true) {
+        gb->ppu.current_window_line++;
+        gb->ppu.window_rendered = false;
     }
     return;
 }
@@ -224,7 +485,8 @@ static void set_ppu_mode(uint8_t mode) {
     if (new_mode_stat_source != INVALID_STAT_SOURCE) {
         trigger_stat_source(new_mode_stat_source);
     }
-    stat_interrupts_t old_mode_stat_source = ppu_mode_to_stat_source(ppu.mode);
+    stat_interrupts_t old_mode_stat_source =
+        ppu_mode_to_stat_source(gb->ppu.mode);
     if (old_mode_stat_source != INVALID_STAT_SOURCE) {
         clear_stat_source(old_mode_stat_source);
     }
@@ -232,11 +494,47 @@ static void set_ppu_mode(uint8_t mode) {
     uint8_t lcd_status = privileged_get_memory_byte(STAT);
     lcd_status &= ~(0x03);
     privileged_set_memory_byte(STAT, lcd_status | mode);
-    ppu.mode = mode;
+    gb->ppu.mode = mode;
 }
 
-uint8_t get_x_pixel(void) { return ppu.line_x; }
+uint8_t get_x_pixel(void) { return gb->ppu.line_x; }
 
-uint8_t get_y_pixel(void) { return ppu.current_scan_line; }
-uint8_t get_window_line(void) { return ppu.current_window_line; }
-void end_ppu(void) { close_ppu = true; }
+uint8_t get_y_pixel(void) { return gb->ppu.current_scan_line; }
+uint8_t get_window_line(void) { return gb->ppu.current_window_line; }
+void set_ppu_renderer(enum PPU_RENDERER renderer) {
+    gb->ppu.renderer = renderer;
+}
+
+// Draws one frame in every `frames`, 1 draws all of them
+void set_frame_skip(uint8_t frames) {
+    gb->ppu.frame_skip = frames > 0 ? frames : 1;
+    gb->ppu.frames_until_drawn = 0;
+}
+
+void set_adaptive_frame_skip(bool adaptive) {
+    gb->ppu.adaptive_frame_skip = adaptive;
+    gb->ppu.frames_on_time = 0;
+}
+
+/*
+ * Called by the throttled CPU at the end of every frame's worth of cycles.
+ * With adaptive frame skip a missed deadline skips one more frame in every
+ * run, and FRAMES_ON_TIME_TO_RECOVER frames on time in a row draw one more
+ * again.
+ */
+void report_frame_deadline(bool missed) {
+    if (!gb->ppu.adaptive_frame_skip) {
+        return;
+    }
+    if (missed) {
+        gb->ppu.frames_on_time = 0;
+        if (gb->ppu.frame_skip < MAX_FRAME_SKIP) {
+            gb->ppu.frame_skip++;
+        }
+    } else if (++gb->ppu.frames_on_time >= FRAMES_ON_TIME_TO_RECOVER) {
+        gb->ppu.frames_on_time = 0;
+        if (gb->ppu.frame_skip > 1) {
+            gb->ppu.frame_skip--;
+        }
+    }
+}
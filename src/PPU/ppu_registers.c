@@ -0,0 +1,74 @@
+#include "ppu_registers.h"
+#include "context.h"
+#include "memory.h"
+#include "ppu_utils.h"
+#include "utils.h"
+
+static void update_tile_starts(PPURegisters *registers) {
+    for (uint16_t index = 0; index < 256; index++) {
+        const uint8_t TILE_INDEX = (uint8_t)index;
+        int32_t tile_start = ADDRESS_MODE_0_BP + TILE_INDEX * 0x10;
+        if (!get_bit(registers->lcdc, 4)) {
+            tile_start = ADDRESS_MODE_1_BP + uint8_to_int8(TILE_INDEX) * 0x10;
+        }
+        registers->tile_starts[index] = (uint16_t)tile_start;
+    }
+}
+
+static void update_shades(uint8_t *shades, uint8_t palette) {
+    for (uint8_t color_id = 0; color_id < 4; color_id++) {
+        shades[color_id] = (palette >> color_id * 2) & 0x03;
+    }
+}
+
+static void update_lcdc(PPURegisters *registers, uint8_t lcdc) {
+    const bool TILE_DATA_CHANGED = get_bit(lcdc ^ registers->lcdc, 4);
+    registers->lcdc = lcdc;
+    registers->bg_tile_map = get_bit(lcdc, 3) ? 0x9C00 : 0x9800;
+    registers->window_tile_map = get_bit(lcdc, 6) ? 0x9C00 : 0x9800;
+    registers->object_height = get_bit(lcdc, 2) ? 16 : 8;
+    if (TILE_DATA_CHANGED) {
+        update_tile_starts(registers);
+    }
+}
+
+void initialize_ppu_registers(void) {
+    PPURegisters *registers = &gb->ppu.registers;
+    for (uint16_t address = LCDC; address <= WX; address++) {
+        update_ppu_register(address, 0);
+    }
+    update_tile_starts(registers);
+}
+
+/*
+ * Called with the value a register holds after every write to it, whether it
+ * came from the CPU or the emulator.
+ */
+void update_ppu_register(uint16_t address, uint8_t byte) {
+    PPURegisters *registers = &gb->ppu.registers;
+    switch (address) {
+        case LCDC: update_lcdc(registers, byte); return;
+        case STAT:
+            registers->stat_selects = byte & 0x78;
+            registers->lyc_coincidence = get_bit(byte, 2);
+            return;
+        case SCY: registers->scy = byte; return;
+        case SCX: registers->scx = byte; return;
+        case LYC: registers->lyc = byte; return;
+        case BGP:
+            registers->bgp = byte;
+            update_shades(registers->bg_shades, byte);
+            return;
+        case OBP0:
+            registers->obp0 = byte;
+            update_shades(registers->obj_shades[0], byte);
+            return;
+        case OBP1:
+            registers->obp1 = byte;
+            update_shades(registers->obj_shades[1], byte);
+            return;
+        case WY: registers->wy = byte; return;
+        case WX: registers->wx = byte; return;
+        default: return;
+    }
+}
@@ -8,4 +8,7 @@ enum COLOR_VALUES { WHITE, LIGHT_GRAY, DARK_GRAY, BLACK, TRANSPARENT, WINDOW_OUT
 uint8_t get_bg_pixel(uint8_t x, uint8_t y);
 uint8_t get_win_pixel(uint8_t x, uint8_t y);
 uint8_t get_obj_pixel(uint8_t x_pixel);
-uint32_t get_color_from_byte(uint8_t byte);
+void get_bg_line(uint8_t *color_ids, uint8_t x_start, uint8_t x_end,
+                 uint8_t y);
+void get_win_line(uint8_t *color_ids, uint8_t x_start, uint8_t x_end,
+                  uint8_t y);
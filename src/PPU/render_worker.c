@@ -0,0 +1,223 @@
+#include "render_worker.h"
+#include "context.h"
+#include "hardware.h"
+#include "memory.h"
+#include "oam_queue.h"
+#include "ppu.h"
+#include "tile_cache.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Comfortably more than a frame's worth, a power of 2 so the indices can wrap
+#define RENDER_LOG_SIZE 8192
+#define VRAM_SIZE (EX_RAM_BASE - VRAM_BASE)
+
+/*
+ * The log is a ring only the CPU thread appends to and only the worker takes
+ * from. The worker sleeps while it's empty and is woken at the end of every
+ * frame, or earlier if the log fills up.
+ */
+struct RenderWorker {
+    render_command_t commands[RENDER_LOG_SIZE];
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    bool stopping;
+    // The worker draws with a context of its own sharing only the frames
+    gameboy_context_t *context;
+    uint8_t vram[VRAM_SIZE];
+    uint8_t oam[OAM_SIZE];
+};
+
+static void run_command(const render_command_t *command) {
+    PPU *ppu = &gb->ppu;
+    switch (command->type) {
+        case RENDER_WRITE:
+            if (command->address >= LCDC && command->address <= WX) {
+                update_ppu_register(command->address, command->byte);
+            } else {
+                privileged_set_memory_byte(command->address, command->byte);
+            }
+            return;
+        case RENDER_SCAN_OBJECTS:
+            ppu->current_scan_line = command->line;
+            if (command->first == 0) {
+                initialize_sprite_store();
+            }
+            for (uint8_t object = command->first; object < command->end;
+                 object++) {
+                add_sprite(object);
+            }
+            return;
+        case RENDER_OBJECT_LINE: build_object_line(); return;
+        case RENDER_PIXELS:
+            ppu->current_scan_line = command->line;
+            ppu->current_window_line = command->window_line;
+            ppu->window_enabled = command->window_enabled;
+            ppu->line_x = command->first;
+            draw_pixels(command->first, command->end);
+            return;
+        case RENDER_PUBLISH: publish_display_buffer(); return;
+        default: return;
+    }
+}
+
+static void *run_render_worker(void *arg) {
+    RenderWorker *worker = arg;
+    set_context(worker->context);
+    uint32_t tail = atomic_load(&worker->tail);
+    while (true) {
+        pthread_mutex_lock(&worker->mutex);
+        while (atomic_load(&worker->head) == tail && !worker->stopping) {
+            pthread_cond_wait(&worker->wake, &worker->mutex);
+        }
+        pthread_mutex_unlock(&worker->mutex);
+        const uint32_t HEAD = atomic_load(&worker->head);
+        if (HEAD == tail) {
+            // Only stopping wakes it up with nothing to do
+            return NULL;
+        }
+        while (tail != HEAD) {
+            run_command(&worker->commands[tail % RENDER_LOG_SIZE]);
+            tail++;
+            atomic_store(&worker->tail, tail);
+        }
+    }
+}
+
+static void wake_worker(RenderWorker *worker) {
+    pthread_mutex_lock(&worker->mutex);
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/*
+ * Hands pixel generation for the current instance over to a new worker that
+ * starts from a copy of the state the PPU draws with. Has to be called after
+ * the cartridge is loaded, which allocates VRAM and OAM, and before the CPU
+ * runs. Returns false if either isn't there yet or the worker can't be
+ * allocated.
+ */
+bool start_render_worker(void) {
+    gameboy_context_t *owner = gb;
+    if (!owner->memory.vram || !owner->memory.oam) {
+        return false;
+    }
+    RenderWorker *worker = calloc(1, sizeof(RenderWorker));
+    if (!worker) {
+        return false;
+    }
+    gameboy_context_t *context = create_context();
+    if (!context) {
+        free(worker);
+        set_context(owner);
+        return false;
+    }
+    memcpy(worker->vram, owner->memory.vram, VRAM_SIZE);
+    memcpy(worker->oam, owner->memory.oam, OAM_SIZE);
+    context->memory.vram = worker->vram;
+    context->memory.oam = worker->oam;
+    context->ppu.registers = owner->ppu.registers;
+    context->ppu.renderer = owner->ppu.renderer;
+    context->hardware.display_buffers = owner->hardware.display_buffers;
+    initialize_tile_cache();
+    set_context(owner);
+
+    worker->context = context;
+    atomic_init(&worker->head, 0);
+    atomic_init(&worker->tail, 0);
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->wake, NULL);
+    owner->ppu.render_worker = worker;
+    pthread_create(&worker->thread, NULL, run_render_worker, worker);
+    return true;
+}
+
+// Lets the worker finish the log and draws on the CPU thread from then on
+void stop_render_worker(void) {
+    RenderWorker *worker = gb->ppu.render_worker;
+    if (!worker) {
+        return;
+    }
+    pthread_mutex_lock(&worker->mutex);
+    worker->stopping = true;
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->mutex);
+    pthread_join(worker->thread, NULL);
+
+    const tile_cache_stats_t STATS = worker->context->tile_cache.stats;
+    gb->tile_cache.stats.hits += STATS.hits;
+    gb->tile_cache.stats.misses += STATS.misses;
+    destroy_context(worker->context);
+    pthread_mutex_destroy(&worker->mutex);
+    pthread_cond_destroy(&worker->wake);
+    free(worker);
+    gb->ppu.render_worker = NULL;
+}
+
+// Waits until every frame logged so far has been drawn
+void flush_render_worker(void) {
+    RenderWorker *worker = gb->ppu.render_worker;
+    if (!worker) {
+        return;
+    }
+    wake_worker(worker);
+    while (atomic_load(&worker->tail) != atomic_load(&worker->head)) {
+        sched_yield();
+    }
+}
+
+static void push_command(render_command_t command) {
+    RenderWorker *worker = gb->ppu.render_worker;
+    const uint32_t HEAD = atomic_load(&worker->head);
+    if (HEAD - atomic_load(&worker->tail) == RENDER_LOG_SIZE) {
+        wake_worker(worker);
+        while (HEAD - atomic_load(&worker->tail) == RENDER_LOG_SIZE) {
+            sched_yield();
+        }
+    }
+    worker->commands[HEAD % RENDER_LOG_SIZE] = command;
+    atomic_store(&worker->head, HEAD + 1);
+}
+
+// Called for every write to VRAM, OAM or the PPU registers
+void log_render_write(uint16_t address, uint8_t byte) {
+    // These only matter for timing, which stays on the CPU thread
+    if (address == STAT || address == LCDY || address == LYC ||
+        address == DMA) {
+        return;
+    }
+    push_command((render_command_t){
+        .type = RENDER_WRITE, .address = address, .byte = byte});
+}
+
+void log_object_scan(uint8_t first, uint8_t end) {
+    push_command((render_command_t){.type = RENDER_SCAN_OBJECTS,
+                                    .line = gb->ppu.current_scan_line,
+                                    .first = first,
+                                    .end = end});
+}
+
+void log_object_line(void) {
+    push_command((render_command_t){.type = RENDER_OBJECT_LINE});
+}
+
+void log_pixels(uint8_t x_start, uint8_t x_end) {
+    push_command((render_command_t){
+        .type = RENDER_PIXELS,
+        .line = gb->ppu.current_scan_line,
+        .first = x_start,
+        .end = x_end,
+        .window_line = gb->ppu.current_window_line,
+        .window_enabled = gb->ppu.window_enabled});
+}
+
+void log_frame_end(void) {
+    push_command((render_command_t){.type = RENDER_PUBLISH});
+    wake_worker(gb->ppu.render_worker);
+}
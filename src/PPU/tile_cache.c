@@ -0,0 +1,53 @@
+#include "tile_cache.h"
+#include "context.h"
+#include "line_kernels.h"
+#include "memory.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+void initialize_tile_cache(void) {
+    TileCache *cache = &gb->tile_cache;
+    memset(cache->dirty, true, sizeof(cache->dirty));
+    memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+// Called for every write into VRAM, only tile data marks anything dirty
+void invalidate_tile(uint16_t address) {
+    if (address >= TILE_DATA_BASE && address < TILE_DATA_END) {
+        gb->tile_cache.dirty[(address - TILE_DATA_BASE) / TILE_SIZE] = true;
+    }
+}
+
+static void decode_tile(uint16_t tile) {
+    uint8_t(*rows)[8][8] = gb->tile_cache.rows[tile];
+    const uint16_t TILE_START = (uint16_t)(TILE_DATA_BASE + tile * TILE_SIZE);
+    const uint8_t *tile_data = &gb->memory.vram[TILE_START - VRAM_BASE];
+    get_line_kernels()->decode_tile(tile_data, rows[0], rows[1]);
+    gb->tile_cache.dirty[tile] = false;
+}
+
+/*
+ * Returns the 8 color IDs of a row of the tile starting at tile_start, which
+ * has to be inside tile data.
+ */
+const uint8_t *get_tile_row(uint16_t tile_start, uint8_t row,
+                            bool x_flipped) {
+    TileCache *cache = &gb->tile_cache;
+    const uint16_t TILE = (uint16_t)((tile_start - TILE_DATA_BASE) / TILE_SIZE);
+    if (cache->dirty[TILE]) {
+        cache->stats.misses++;
+        decode_tile(TILE);
+    } else {
+        cache->stats.hits++;
+    }
+    return cache->rows[TILE][x_flipped][row];
+}
+
+tile_cache_stats_t get_tile_cache_stats(void) { return gb->tile_cache.stats; }
+
+void print_tile_cache_stats(void) {
+    fprintf(stderr,
+            "Tile cache: %" PRIu64 " row hits, %" PRIu64 " tile decodes\n",
+            gb->tile_cache.stats.hits, gb->tile_cache.stats.misses);
+}
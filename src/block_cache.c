@@ -0,0 +1,184 @@
+#include "block_cache.h"
+#include "context.h"
+#include "decoder.h"
+#include "hardware.h"
+#include "idle_loop.h"
+#include "memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint16_t hash_block(uint16_t bank, uint16_t pc) {
+    return (pc ^ (uint16_t)(bank << 7)) & (BLOCK_CACHE_BUCKETS - 1);
+}
+
+static bool ends_block(uint8_t opcode) {
+    switch (opcode) {
+        /* clang-format off */
+        case 0x10: case 0x76: case 0xF3: case 0xFB:           // STOP HALT DI EI
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: // JP
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: // RET
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF:            // RST
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: // illegal
+        case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+            /* clang-format on */
+            return true;
+        default: return false;
+    }
+}
+
+/*
+ * Only cartridge ROM is cached. Everything from VRAM up (cartridge RAM, WRAM,
+ * HRAM) is writable so code there is always fetched by the interpreter, as is
+ * the boot ROM while it is mapped over the cartridge.
+ */
+bool is_cacheable_address(uint16_t address) {
+    if (address >= VRAM_BASE) {
+        return false;
+    }
+    if (is_dmg_mapped() && address < ROM_START) {
+        return false;
+    }
+    return true;
+}
+
+static basic_block_t *decode_block(uint16_t bank, uint16_t pc) {
+    cached_instruction_t instructions[MAX_BLOCK_INSTRUCTIONS];
+    uint16_t region_end = pc < ROM_BANK_NN_BASE ? ROM_BANK_NN_BASE : VRAM_BASE;
+    uint8_t count = 0;
+
+    while (count < MAX_BLOCK_INSTRUCTIONS) {
+        cached_instruction_t *cached = &instructions[count];
+        uint8_t opcode = get_memory_byte(pc);
+        uint8_t prefixed_opcode =
+            pc + 1 < region_end ? get_memory_byte((uint16_t)(pc + 1)) : 0;
+        const opcode_info_t *opcode_info =
+            decode_opcode(opcode, prefixed_opcode);
+        if (pc + opcode_info->length > region_end) {
+            // Operands live in a different bank, leave it to the interpreter
+            break;
+        }
+        memset(cached->instruction, 0, MAX_INSTRUCTION_SIZE);
+        for (uint8_t i = 0; i < opcode_info->length; i++) {
+            cached->instruction[i] = get_memory_byte((uint16_t)(pc + i));
+        }
+        cached->execute = opcode_info->execute;
+        cached->pc = pc;
+        cached->length = opcode_info->length;
+        count++;
+        pc = (uint16_t)(pc + opcode_info->length);
+        if (ends_block(opcode) || pc >= region_end) {
+            break;
+        }
+    }
+    if (count == 0) {
+        return NULL;
+    }
+
+    basic_block_t *block =
+        malloc(sizeof(basic_block_t) + count * sizeof(cached_instruction_t));
+    if (!block) {
+        fprintf(stderr, "Unable to allocate memory for block cache\n");
+        exit(1);
+    }
+    block->bank = bank;
+    block->start_pc = instructions[0].pc;
+    block->instruction_count = count;
+    block->execution_count = 0;
+    block->native_failed = false;
+    block->may_idle = is_idle_loop_candidate(instructions, count);
+    block->native = NULL;
+    block->clocks_before_last = 0;
+    memcpy(block->instructions, instructions,
+           count * sizeof(cached_instruction_t));
+    find_polled_sources(block);
+    return block;
+}
+
+basic_block_t *lookup_block(uint16_t pc) {
+    if (!is_cacheable_address(pc)) {
+        return NULL;
+    }
+    uint16_t bank = get_rom_bank(pc);
+    uint16_t bucket = hash_block(bank, pc);
+    basic_block_t **buckets = gb->block_cache.buckets;
+    for (basic_block_t *block = buckets[bucket]; block; block = block->next) {
+        if (block->start_pc == pc && block->bank == bank) {
+            return block;
+        }
+    }
+    basic_block_t *block = decode_block(bank, pc);
+    if (block) {
+        block->next = buckets[bucket];
+        buckets[bucket] = block;
+    }
+    return block;
+}
+
+bool block_cursor_continues(uint16_t pc) {
+    const BlockCache *cache = &gb->block_cache;
+    return cache->cursor_block &&
+           cache->cursor_index < cache->cursor_block->instruction_count &&
+           cache->cursor_block->instructions[cache->cursor_index].pc == pc;
+}
+
+void set_block_cursor(basic_block_t *block) {
+    gb->block_cache.cursor_block = block;
+    gb->block_cache.cursor_index = 0;
+}
+
+clock_cycles_t run_cached_instruction(cached_instruction_t *cached) {
+    set_pc((uint16_t)(cached->pc + cached->length));
+#ifdef ENABLE_DEBUGGER
+    memcpy(get_instruction(), cached->instruction, MAX_INSTRUCTION_SIZE);
+#endif
+    inc_instruction_count();
+    clock_cycles_t clocks = cached->execute(cached->instruction);
+    if (clocks >= 0) {
+        return clocks;
+    }
+    set_is_implemented(false);
+    return -1;
+}
+
+clock_cycles_t execute_cached_instruction(void) {
+    BlockCache *cache = &gb->block_cache;
+    uint16_t pc = get_pc();
+    clock_cycles_t skipped_clocks = 0;
+    if (!block_cursor_continues(pc)) {
+        set_block_cursor(lookup_block(pc));
+        skipped_clocks = skip_idle_loop(cache->cursor_block);
+        if (!cache->cursor_block) {
+            return execute_instruction(fetch_instruction());
+        }
+    }
+    return skipped_clocks +
+           run_cached_instruction(
+               &cache->cursor_block->instructions[cache->cursor_index++]);
+}
+
+void invalidate_block_cursor(void) {
+    gb->block_cache.cursor_block = NULL;
+    gb->block_cache.cursor_index = 0;
+    gb->block_cache.mapping_generation++;
+}
+
+uint32_t get_block_mapping_generation(void) {
+    return gb->block_cache.mapping_generation;
+}
+
+void destroy_block_cache(void) {
+    for (uint16_t i = 0; i < BLOCK_CACHE_BUCKETS; i++) {
+        basic_block_t *block = gb->block_cache.buckets[i];
+        while (block) {
+            basic_block_t *next = block->next;
+            free(block);
+            block = next;
+        }
+        gb->block_cache.buckets[i] = NULL;
+    }
+    invalidate_block_cursor();
+}
@@ -0,0 +1,34 @@
+#include "context.h"
+#include <stdlib.h>
+
+_Thread_local gameboy_context_t *gb = NULL;
+
+/*
+ * Allocates a zeroed instance and makes it current on the calling thread, or
+ * returns NULL if it can't be allocated. The components still have to be
+ * initialized before it can run.
+ */
+gameboy_context_t *create_context(void) {
+    gameboy_context_t *context = calloc(1, sizeof(gameboy_context_t));
+    if (!context) {
+        return NULL;
+    }
+    pthread_mutex_init(&context->dots_mutex, NULL);
+    context->cpu.mode = INTERPRETER;
+    context->cpu.throttled = true;
+    gb = context;
+    return context;
+}
+
+void destroy_context(gameboy_context_t *context) {
+    if (!context) {
+        return;
+    }
+    pthread_mutex_destroy(&context->dots_mutex);
+    if (gb == context) {
+        gb = NULL;
+    }
+    free(context);
+}
+
+void set_context(gameboy_context_t *context) { gb = context; }
@@ -1,10 +1,13 @@
 #include "cpu.h"
+#include "block_cache.h"
+#include "context.h"
 #include "decoder.h"
 #include "hardware.h"
 #include "interrupts.h"
+#include "jit.h"
 #include "memory.h"
-#include "oam_queue.h"
 #include "ppu.h"
+#include "scheduler.h"
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
@@ -15,9 +18,6 @@
 #include <unistd.h>
 #endif
 
-bool step_mode = false;
-bool close_cpu = false;
-bool boot_completed = false;
 #define CYCLES_PER_FRAME 69905
 struct timespec diff_timespec(const struct timespec *time1,
                               const struct timespec *time0) {
@@ -31,67 +31,94 @@ struct timespec diff_timespec(const struct timespec *time1,
     }
     return diff;
 }
-void *start_cpu(void *arg) {
-    (void)arg;
-    struct timespec start, end, diff, wait_time;
-    uint32_t exec_count = 0;
-    clock_gettime(CLOCK_REALTIME, &start);
+static clock_cycles_t step_instruction(void) {
+    switch (gb->cpu.mode) {
+        case BLOCK_CACHE:
+        case JIT: return execute_cached_instruction();
+        case INTERPRETER:
+        default: return execute_instruction(fetch_instruction());
+    }
+}
 
-    while (true) {
-        clock_cycles_t clocks = 0;
-        if (close_cpu) {
-            break;
-        }
-        if (get_is_implemented() == false) {
-            step_mode = true;
-        }
-        if (step_mode && instructions_left <= 0) {
-            ppu.ready_to_render = true;
-            continue;
-        } else if (step_mode) {
-            instructions_left -= 1;
+/*
+ * Advances the scheduler by the clocks taken by the last step and sleeps off
+ * whatever is left of the frame once a frame's worth of clocks has run.
+ */
+static void retire_clocks(clock_cycles_t clocks) {
+    CPU *cpu = &gb->cpu;
+    advance_cycles(clocks);
+    if (!cpu->throttled) {
+        return;
+    }
+    cpu->exec_count += (uint32_t)clocks;
+    if (cpu->exec_count >= CYCLES_PER_FRAME && !cpu->step_mode) {
+        struct timespec frame_end, diff, wait_time = {0, 0};
+        cpu->exec_count -= CYCLES_PER_FRAME;
+        clock_gettime(CLOCK_REALTIME, &frame_end);
+        diff = diff_timespec(&frame_end, &cpu->frame_start);
+        wait_time.tv_nsec = 13333337 - diff.tv_nsec;
+        report_frame_deadline(diff.tv_sec > 0 || wait_time.tv_nsec <= 0);
+        if (diff.tv_sec == 0 && wait_time.tv_nsec > 0) {
+            nanosleep(&wait_time, &wait_time);
         }
+        clock_gettime(CLOCK_REALTIME, &cpu->frame_start);
+    }
+}
 
-        if (!(get_memory_byte(IE) & get_memory_byte(IF))) {
-            set_halted(false);
-        }
-        clocks += handle_interrupts();
+/*
+ * Only an event can raise an interrupt while the CPU is halted, so rather than
+ * idling 4 clocks at a time the CPU skips straight to the step the next event
+ * would have been handled on.
+ */
+static clock_cycles_t get_halted_clocks(void) {
+    const uint64_t NEXT_EVENT = get_next_event_cycle();
+    if (NEXT_EVENT == UINT64_MAX) {
+        return FOUR_CLOCKS;
+    }
+    const uint64_t CYCLES_LEFT = NEXT_EVENT - get_cycles();
+    return (clock_cycles_t)((CYCLES_LEFT + 3) / 4 * 4);
+}
+
+/*
+ * Runs a single instruction, along with any interrupt dispatch in front of it,
+ * or a single step of HALT, and retires its clocks. During OAM DMA the
+ * instructions are interpreted so their fetches see the blocked bus.
+ */
+void step_cpu(void) {
+    clock_cycles_t clocks = 0;
+    if (gb->interrupts.pending) {
+        set_halted(false);
+    }
+    clocks += handle_interrupts();
 
 #if defined(__APPLE__) || defined(__unix__)
-        pthread_mutex_lock(&dots_mutex);
+    pthread_mutex_lock(&gb->dots_mutex);
 #endif
-        if (!is_halted()) {
-            clock_cycles_t clocks_from_dma_transfer = try_oam_dma_transfer();
-            if (!clocks_from_dma_transfer) {
-                clock_cycles_t (*func)(uint8_t *) = fetch_instruction();
-                clocks += execute_instruction(func);
-            } else {
-                clocks += clocks_from_dma_transfer;
-            }
-        } else {
-            clocks += 4;
-        }
+    if (get_oam_dma_transfer() && !is_halted()) {
+        clocks += execute_instruction(fetch_instruction());
+    } else if (!is_halted()) {
+        // A compiled block runs as one step
+        const clock_cycles_t BLOCK_CLOCKS =
+            gb->cpu.mode == JIT ? execute_jit_block(clocks) : INVALID_CLOCKS;
+        clocks += BLOCK_CLOCKS != INVALID_CLOCKS ? BLOCK_CLOCKS
+                                                 : step_instruction();
+    } else {
+        clocks += get_halted_clocks();
+    }
 
 #if defined(__APPLE__) || defined(__unix__)
-        pthread_mutex_unlock(&dots_mutex);
+    pthread_mutex_unlock(&gb->dots_mutex);
 #endif
-        update_timer(clocks);
-        run_ppu((uint16_t)clocks);
-        exec_count += (uint32_t)clocks;
-        if (exec_count >= CYCLES_PER_FRAME && !step_mode) {
-            exec_count -= CYCLES_PER_FRAME;
-            clock_gettime(CLOCK_REALTIME, &end);
-            diff = diff_timespec(&end, &start);
-            wait_time.tv_nsec = 13333337 - diff.tv_nsec;
-            if (wait_time.tv_nsec > 0) {
-                nanosleep(&wait_time, &wait_time);
-            }
-            clock_gettime(CLOCK_REALTIME, &start);
-        }
-    }
-    return NULL;
+    retire_clocks(clocks);
 }
 
-void end_cpu(void) { close_cpu = true; }
-void toggle_step_mode(void) { step_mode = !step_mode; }
-bool get_step_mode(void) { return step_mode; }
+bool get_step_mode(void) { return gb->cpu.step_mode; }
+void set_cpu_mode(enum CPU_MODE mode) { gb->cpu.mode = mode; }
+enum CPU_MODE get_cpu_mode(void) { return gb->cpu.mode; }
+
+// The first frame is timed from when the throttle is enabled
+void set_cpu_throttle(bool enabled) {
+    gb->cpu.throttled = enabled;
+    gb->cpu.exec_count = 0;
+    clock_gettime(CLOCK_REALTIME, &gb->cpu.frame_start);
+}
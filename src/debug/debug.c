@@ -1,4 +1,5 @@
 #include "debug.h"
+#include "context.h"
 #include "decoder.h"
 #include "hardware.h"
 #include "interrupts.h"
@@ -10,6 +11,7 @@
 #include <ncurses.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static void print_register_window(WINDOW *reg_win);
@@ -23,6 +25,8 @@ static void print_display_buffer_window(WINDOW *display_buf_win,
                                         const uint16_t start_address);
 
 void refresh_debugger(void);
+static void mvwprintwhcenter(WINDOW *win, int row, int row_start, int width,
+                             const char *str, ...);
 WINDOW *display_buff_win;
 WINDOW *registers_win;
 WINDOW *cpu_win;
@@ -37,6 +41,16 @@ uint16_t display_buf_addr = 0x0;
 pthread_mutex_t debugger_lock = PTHREAD_MUTEX_INITIALIZER;
 bool close_debugger;
 
+static void mvwprintwhcenter(WINDOW *win, int row, int row_start, int width,
+                             const char *str, ...) {
+    char formatted_string[UINT8_MAX];
+    va_list args;
+    va_start(args, str);
+    vsnprintf(formatted_string, UINT8_MAX, str, args);
+    int len = (int)strnlen(formatted_string, UINT8_MAX);
+    mvwprintw(win, row, row_start + (width / 2) - (len / 2), formatted_string);
+}
+
 void end_debugger(void) {
     close_debugger = true;
     pthread_mutex_lock(&debugger_lock);
@@ -48,8 +62,9 @@ void end_debugger(void) {
     pthread_mutex_unlock(&debugger_lock);
     return;
 }
+// Takes the context of the instance being debugged
 void *initialize_debugger(void *arg) {
-    (void)arg;
+    set_context(arg);
     pthread_mutex_lock(&debugger_lock);
     initscr();
     start_color();
@@ -284,7 +299,7 @@ static void print_ppu_window(WINDOW *ppu_win) {
                      get_stat_line());
     mvwprintwhcenter(ppu_win, 13, 0, WIDTH / 2, "STAT REG");
     mvwprintwhcenter(ppu_win, 13, WIDTH / 2, WIDTH / 2, "0x%0.2x",
-                     get_memory_byte(STAT));
+                     privileged_get_memory_byte(STAT));
 
     uint32_t *serviced_stat_interrupts = get_serviced_stat_interrupts();
     mvwprintwhcenter(ppu_win, 14, 0, WIDTH / 2, "MODE 0 ");
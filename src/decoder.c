@@ -4,649 +4,560 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static clock_cycles_t (
-    *decode_unprefixed_instruction(uint8_t instruction[MAX_INSTRUCTION_SIZE]))(
-    uint8_t instruction[MAX_INSTRUCTION_SIZE]);
-static clock_cycles_t (
-    *decode_prefixed_instruction(uint8_t instruction[MAX_INSTRUCTION_SIZE]))(
-    uint8_t instruction[MAX_INSTRUCTION_SIZE]);
+/*
+ * Opcode tables indexed by the opcode byte. 0xCB in the unprefixed table is
+ * only the prefix, its instructions live in prefixed_opcodes indexed by the
+ * second byte.
+ */
+/* clang-format off */
+static const opcode_info_t unprefixed_opcodes[256] = {
+    [0x00] = {&NOP, 1, FOUR_CLOCKS},
+    [0x01] = {&LD_LONG_R_IMM, 3, TWELVE_CLOCKS},
+    [0x02] = {&LD_ADDR_LONG_R_A, 1, EIGHT_CLOCKS},
+    [0x03] = {&INC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x04] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x05] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x06] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x07] = {&RLCA, 1, FOUR_CLOCKS},
+    [0x08] = {&LD_ADDR_IMM_SP, 3, TWENTY_CLOCKS},
+    [0x09] = {&ADD_HL_LONG_R, 1, EIGHT_CLOCKS},
+    [0x0A] = {&LD_A_DEREF_LONG_R, 1, EIGHT_CLOCKS},
+    [0x0B] = {&DEC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x0C] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x0D] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x0E] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x0F] = {&RRCA, 1, FOUR_CLOCKS},
+    [0x10] = {&STOP, 1, FOUR_CLOCKS},
+    [0x11] = {&LD_LONG_R_IMM, 3, TWELVE_CLOCKS},
+    [0x12] = {&LD_ADDR_LONG_R_A, 1, EIGHT_CLOCKS},
+    [0x13] = {&INC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x14] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x15] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x16] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x17] = {&RLA, 1, FOUR_CLOCKS},
+    [0x18] = {&JR_IMM, 2, TWELVE_CLOCKS},
+    [0x19] = {&ADD_HL_LONG_R, 1, EIGHT_CLOCKS},
+    [0x1A] = {&LD_A_DEREF_LONG_R, 1, EIGHT_CLOCKS},
+    [0x1B] = {&DEC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x1C] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x1D] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x1E] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x1F] = {&RRA, 1, FOUR_CLOCKS},
+    [0x20] = {&JR_NZ_IMM, 2, EIGHT_CLOCKS},
+    [0x21] = {&LD_LONG_R_IMM, 3, TWELVE_CLOCKS},
+    [0x22] = {&LD_ADDR_HL_INC_A, 1, EIGHT_CLOCKS},
+    [0x23] = {&INC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x24] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x25] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x26] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x27] = {&DAA, 1, FOUR_CLOCKS},
+    [0x28] = {&JR_Z_IMM, 2, EIGHT_CLOCKS},
+    [0x29] = {&ADD_HL_LONG_R, 1, EIGHT_CLOCKS},
+    [0x2A] = {&LD_A_DEREF_HL_INC, 1, EIGHT_CLOCKS},
+    [0x2B] = {&DEC_LONG_R, 1, EIGHT_CLOCKS},
+    [0x2C] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x2D] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x2E] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x2F] = {&CPL, 1, FOUR_CLOCKS},
+    [0x30] = {&JR_NC_IMM, 2, EIGHT_CLOCKS},
+    [0x31] = {&LD_SP_IMM, 3, TWELVE_CLOCKS},
+    [0x32] = {&LD_ADDR_HL_DEC_A, 1, EIGHT_CLOCKS},
+    [0x33] = {&INC_SP, 1, EIGHT_CLOCKS},
+    [0x34] = {&INC_DEREF_HL, 1, TWELVE_CLOCKS},
+    [0x35] = {&DEC_DEREF_HL, 1, TWELVE_CLOCKS},
+    [0x36] = {&LD_ADDR_HL_IMM, 2, TWELVE_CLOCKS},
+    [0x37] = {&SCF, 1, FOUR_CLOCKS},
+    [0x38] = {&JR_C_IMM, 2, EIGHT_CLOCKS},
+    [0x39] = {&ADD_HL_SP, 1, EIGHT_CLOCKS},
+    [0x3A] = {&LD_A_DEREF_HL_DEC, 1, EIGHT_CLOCKS},
+    [0x3B] = {&DEC_SP, 1, EIGHT_CLOCKS},
+    [0x3C] = {&INC_R, 1, FOUR_CLOCKS},
+    [0x3D] = {&DEC_R, 1, FOUR_CLOCKS},
+    [0x3E] = {&LD_R_IMM, 2, EIGHT_CLOCKS},
+    [0x3F] = {&CCF, 1, FOUR_CLOCKS},
+    [0x40] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x41] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x42] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x43] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x44] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x45] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x46] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x47] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x48] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x49] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x4A] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x4B] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x4C] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x4D] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x4E] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x4F] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x50] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x51] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x52] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x53] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x54] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x55] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x56] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x57] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x58] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x59] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x5A] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x5B] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x5C] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x5D] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x5E] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x5F] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x60] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x61] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x62] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x63] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x64] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x65] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x66] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x67] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x68] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x69] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x6A] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x6B] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x6C] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x6D] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x6E] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x6F] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x70] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x71] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x72] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x73] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x74] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x75] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x76] = {&HALT, 1, FOUR_CLOCKS},
+    [0x77] = {&LD_ADDR_HL_R, 1, EIGHT_CLOCKS},
+    [0x78] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x79] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x7A] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x7B] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x7C] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x7D] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x7E] = {&LD_R_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x7F] = {&LD_RR, 1, FOUR_CLOCKS},
+    [0x80] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x81] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x82] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x83] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x84] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x85] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x86] = {&ADD_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x87] = {&ADD_A_R, 1, FOUR_CLOCKS},
+    [0x88] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x89] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x8A] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x8B] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x8C] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x8D] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x8E] = {&ADC_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x8F] = {&ADC_A_R, 1, FOUR_CLOCKS},
+    [0x90] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x91] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x92] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x93] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x94] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x95] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x96] = {&SUB_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x97] = {&SUB_A_R, 1, FOUR_CLOCKS},
+    [0x98] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x99] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x9A] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x9B] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x9C] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x9D] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0x9E] = {&SBC_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0x9F] = {&SBC_A_R, 1, FOUR_CLOCKS},
+    [0xA0] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA1] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA2] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA3] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA4] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA5] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA6] = {&AND_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0xA7] = {&AND_A_R, 1, FOUR_CLOCKS},
+    [0xA8] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xA9] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xAA] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xAB] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xAC] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xAD] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xAE] = {&XOR_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0xAF] = {&XOR_A_R, 1, FOUR_CLOCKS},
+    [0xB0] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB1] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB2] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB3] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB4] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB5] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB6] = {&OR_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0xB7] = {&OR_A_R, 1, FOUR_CLOCKS},
+    [0xB8] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xB9] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xBA] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xBB] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xBC] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xBD] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xBE] = {&CP_A_DEREF_HL, 1, EIGHT_CLOCKS},
+    [0xBF] = {&CP_A_R, 1, FOUR_CLOCKS},
+    [0xC0] = {&RET_NZ, 1, EIGHT_CLOCKS},
+    [0xC1] = {&POP_LONG_R, 1, TWELVE_CLOCKS},
+    [0xC2] = {&JP_NZ_IMM, 3, TWELVE_CLOCKS},
+    [0xC3] = {&JP_IMM, 3, SIXTEEN_CLOCKS},
+    [0xC4] = {&CALL_NZ_IMM, 3, TWELVE_CLOCKS},
+    [0xC5] = {&PUSH_LONG_R, 1, SIXTEEN_CLOCKS},
+    [0xC6] = {&ADD_A_IMM, 2, EIGHT_CLOCKS},
+    [0xC7] = {&RST_x0h, 1, SIXTEEN_CLOCKS},
+    [0xC8] = {&RET_Z, 1, EIGHT_CLOCKS},
+    [0xC9] = {&RET, 1, SIXTEEN_CLOCKS},
+    [0xCA] = {&JP_Z_IMM, 3, TWELVE_CLOCKS},
+    [0xCB] = {NULL, 2, FOUR_CLOCKS},
+    [0xCC] = {&CALL_Z_IMM, 3, TWELVE_CLOCKS},
+    [0xCD] = {&CALL_IMM, 3, TWENTY_FOUR_CLOCKS},
+    [0xCE] = {&ADC_A_IMM, 2, EIGHT_CLOCKS},
+    [0xCF] = {&RST_x8h, 1, SIXTEEN_CLOCKS},
+    [0xD0] = {&RET_NC, 1, EIGHT_CLOCKS},
+    [0xD1] = {&POP_LONG_R, 1, TWELVE_CLOCKS},
+    [0xD2] = {&JP_NC_IMM, 3, TWELVE_CLOCKS},
+    [0xD3] = {&UNK, 1, INVALID_CLOCKS},
+    [0xD4] = {&CALL_NC_IMM, 3, TWELVE_CLOCKS},
+    [0xD5] = {&PUSH_LONG_R, 1, SIXTEEN_CLOCKS},
+    [0xD6] = {&SUB_A_IMM, 2, EIGHT_CLOCKS},
+    [0xD7] = {&RST_x0h, 1, SIXTEEN_CLOCKS},
+    [0xD8] = {&RET_C, 1, EIGHT_CLOCKS},
+    [0xD9] = {&RETI, 1, SIXTEEN_CLOCKS},
+    [0xDA] = {&JP_C_IMM, 3, TWELVE_CLOCKS},
+    [0xDB] = {&UNK, 1, INVALID_CLOCKS},
+    [0xDC] = {&CALL_C_IMM, 3, TWELVE_CLOCKS},
+    [0xDD] = {&UNK, 1, INVALID_CLOCKS},
+    [0xDE] = {&SBC_A_IMM, 2, EIGHT_CLOCKS},
+    [0xDF] = {&RST_x8h, 1, SIXTEEN_CLOCKS},
+    [0xE0] = {&LD_ADDR_FF00_PLUS_IMM_REGISTER_A, 2, TWELVE_CLOCKS},
+    [0xE1] = {&POP_LONG_R, 1, TWELVE_CLOCKS},
+    [0xE2] = {&LD_DEREF_FF00_PLUS_C_A, 1, EIGHT_CLOCKS},
+    [0xE3] = {&UNK, 1, INVALID_CLOCKS},
+    [0xE4] = {&UNK, 1, INVALID_CLOCKS},
+    [0xE5] = {&PUSH_LONG_R, 1, SIXTEEN_CLOCKS},
+    [0xE6] = {&AND_A_IMM, 2, EIGHT_CLOCKS},
+    [0xE7] = {&RST_x0h, 1, SIXTEEN_CLOCKS},
+    [0xE8] = {&ADD_SP_IMM, 2, SIXTEEN_CLOCKS},
+    [0xE9] = {&JP_HL, 1, FOUR_CLOCKS},
+    [0xEA] = {&LD_ADDR_IMM_A, 3, SIXTEEN_CLOCKS},
+    [0xEB] = {&UNK, 1, INVALID_CLOCKS},
+    [0xEC] = {&UNK, 1, INVALID_CLOCKS},
+    [0xED] = {&UNK, 1, INVALID_CLOCKS},
+    [0xEE] = {&XOR_A_IMM, 2, EIGHT_CLOCKS},
+    [0xEF] = {&RST_x8h, 1, SIXTEEN_CLOCKS},
+    [0xF0] = {&LD_A_DEREF_FF00_PLUS_IMM, 2, TWELVE_CLOCKS},
+    [0xF1] = {&POP_LONG_AF, 1, TWELVE_CLOCKS},
+    [0xF2] = {&LD_A_DEREF_FF00_PLUS_C, 1, EIGHT_CLOCKS},
+    [0xF3] = {&DI, 1, FOUR_CLOCKS},
+    [0xF4] = {&UNK, 1, INVALID_CLOCKS},
+    [0xF5] = {&PUSH_AF, 1, SIXTEEN_CLOCKS},
+    [0xF6] = {&OR_A_IMM, 2, EIGHT_CLOCKS},
+    [0xF7] = {&RST_x0h, 1, SIXTEEN_CLOCKS},
+    [0xF8] = {&LD_HL_SP_PLUS_IMM, 2, TWELVE_CLOCKS},
+    [0xF9] = {&LD_SP_HL, 1, EIGHT_CLOCKS},
+    [0xFA] = {&LD_A_DEREF_IMM, 3, SIXTEEN_CLOCKS},
+    [0xFB] = {&EI, 1, FOUR_CLOCKS},
+    [0xFC] = {&UNK, 1, INVALID_CLOCKS},
+    [0xFD] = {&UNK, 1, INVALID_CLOCKS},
+    [0xFE] = {&CP_A_IMM, 2, EIGHT_CLOCKS},
+    [0xFF] = {&RST_x8h, 1, SIXTEEN_CLOCKS},
+};
 
-clock_cycles_t (*fetch_instruction(void))(
-    uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
-    clock_cycles_t (*execute_func)(uint8_t *);
-    clear_instruction();
-    if (get_memory_byte(get_pc()) == 0xCB) {
-        // Instruction has 0xCB prefix
-        append_instruction(0);
-        append_instruction(1);
-        execute_func = decode_prefixed_instruction(get_instruction());
-    } else {
-        append_instruction(0);
-        execute_func = decode_unprefixed_instruction(get_instruction());
-    }
-    return execute_func;
-}
+static const opcode_info_t prefixed_opcodes[256] = {
+    [0x00] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x01] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x02] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x03] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x04] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x05] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x06] = {&RLC_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x07] = {&RLC_R, 2, EIGHT_CLOCKS},
+    [0x08] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x09] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x0A] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x0B] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x0C] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x0D] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x0E] = {&RRC_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x0F] = {&RRC_R, 2, EIGHT_CLOCKS},
+    [0x10] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x11] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x12] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x13] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x14] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x15] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x16] = {&RL_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x17] = {&RL_R, 2, EIGHT_CLOCKS},
+    [0x18] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x19] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x1A] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x1B] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x1C] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x1D] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x1E] = {&RR_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x1F] = {&RR_R, 2, EIGHT_CLOCKS},
+    [0x20] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x21] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x22] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x23] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x24] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x25] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x26] = {&SLA_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x27] = {&SLA_R, 2, EIGHT_CLOCKS},
+    [0x28] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x29] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x2A] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x2B] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x2C] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x2D] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x2E] = {&SRA_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x2F] = {&SRA_R, 2, EIGHT_CLOCKS},
+    [0x30] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x31] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x32] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x33] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x34] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x35] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x36] = {&SWAP_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x37] = {&SWAP_R, 2, EIGHT_CLOCKS},
+    [0x38] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x39] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x3A] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x3B] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x3C] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x3D] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x3E] = {&SRL_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x3F] = {&SRL_R, 2, EIGHT_CLOCKS},
+    [0x40] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x41] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x42] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x43] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x44] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x45] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x46] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x47] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x48] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x49] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x4A] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x4B] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x4C] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x4D] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x4E] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x4F] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x50] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x51] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x52] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x53] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x54] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x55] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x56] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x57] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x58] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x59] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x5A] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x5B] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x5C] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x5D] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x5E] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x5F] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x60] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x61] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x62] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x63] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x64] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x65] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x66] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x67] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x68] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x69] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x6A] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x6B] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x6C] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x6D] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x6E] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x6F] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x70] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x71] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x72] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x73] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x74] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x75] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x76] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x77] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x78] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x79] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x7A] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x7B] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x7C] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x7D] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x7E] = {&BIT_B_DEREF_HL, 2, TWELVE_CLOCKS},
+    [0x7F] = {&BIT_B_R, 2, EIGHT_CLOCKS},
+    [0x80] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x81] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x82] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x83] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x84] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x85] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x86] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x87] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x88] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x89] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x8A] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x8B] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x8C] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x8D] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x8E] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x8F] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x90] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x91] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x92] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x93] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x94] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x95] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x96] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x97] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x98] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x99] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x9A] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x9B] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x9C] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x9D] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0x9E] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0x9F] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA0] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA1] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA2] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA3] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA4] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA5] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA6] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xA7] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA8] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xA9] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xAA] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xAB] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xAC] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xAD] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xAE] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xAF] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB0] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB1] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB2] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB3] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB4] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB5] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB6] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xB7] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB8] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xB9] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xBA] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xBB] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xBC] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xBD] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xBE] = {&RES_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xBF] = {&RES_B_R, 2, EIGHT_CLOCKS},
+    [0xC0] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC1] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC2] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC3] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC4] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC5] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC6] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xC7] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC8] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xC9] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xCA] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xCB] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xCC] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xCD] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xCE] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xCF] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD0] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD1] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD2] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD3] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD4] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD5] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD6] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xD7] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD8] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xD9] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xDA] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xDB] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xDC] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xDD] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xDE] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xDF] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE0] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE1] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE2] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE3] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE4] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE5] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE6] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xE7] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE8] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xE9] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xEA] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xEB] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xEC] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xED] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xEE] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xEF] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF0] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF1] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF2] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF3] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF4] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF5] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF6] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xF7] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF8] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xF9] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xFA] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xFB] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xFC] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xFD] = {&SET_B_R, 2, EIGHT_CLOCKS},
+    [0xFE] = {&SET_B_DEREF_HL, 2, SIXTEEN_CLOCKS},
+    [0xFF] = {&SET_B_R, 2, EIGHT_CLOCKS},
+};
+/* clang-format on */
 
-clock_cycles_t execute_instruction(
-    clock_cycles_t execute_func(uint8_t instruction[MAX_INSTRUCTION_SIZE])) {
-    if (execute_func) {
-        inc_instruction_count();
-        clock_cycles_t clocks = (*execute_func)(get_instruction());
-        if (clocks >= 0) {
-            return clocks;
-        }
+const opcode_info_t *decode_opcode(uint8_t opcode, uint8_t prefixed_opcode) {
+    if (opcode == 0xCB) {
+        return &prefixed_opcodes[prefixed_opcode];
     }
-    set_is_implemented(false);
-    return -1;
+    return &unprefixed_opcodes[opcode];
 }
 
-static clock_cycles_t (*decode_prefixed_instruction(
-    uint8_t instruction[MAX_INSTRUCTION_SIZE]))(uint8_t *instruction) {
-    const uint8_t OPCODE = instruction[1];
-    switch (OPCODE) {
-            /* clang-format off */
-        case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x05: case 0x07: 
-        {
-            return &RLC_R;
-        }
-        case 0x06: {
-            return &RLC_DEREF_HL;
-        }
-        case 0x08: case 0x09: case 0x0a: case 0x0b: case 0x0c: case 0x0d: case 0x0f: 
-        {
-            return &RRC_R;
-        }
-        case 0x0e: {
-            return &RRC_DEREF_HL;
-        }
-        case 0x10: case 0x11: case 0x12: case 0x13: case 0x14: case 0x15: case 0x17:
-        {
-            return &RL_R;
-        }
-        case 0x16: 
-        {
-            return &RL_DEREF_HL;
-        }
-        case 0x18: case 0x19: case 0x1a: case 0x1b: case 0x1c: case 0x1d: case 0x1f: 
-        {
-            return &RR_R;
-        }
-        case 0x1e: 
-        {
-            return &RR_DEREF_HL;
-        }
-        case 0x20: case 0x21: case 0x22: case 0x23: case 0x24: case 0x25: case 0x27: 
-        {
-            return &SLA_R;
-        }
-        case 0x26: 
-        {
-            return &SLA_DEREF_HL;
-        }
-        case 0x28: case 0x29: case 0x2a: case 0x2b: case 0x2c: case 0x2d: case 0x2f: 
-        {
-            return &SRA_R;
-        }
-        case 0x2e: 
-        {
-            return &SRA_DEREF_HL;
-        }
-        case 0x30: case 0x31: case 0x32: case 0x33: case 0x34: case 0x35: case 0x37: 
-        {
-            return &SWAP_R;
-        }
-        case 0x36: 
-        {
-            return &SWAP_DEREF_HL;
-        }
-        case 0x38: case 0x39: case 0x3a: case 0x3b: case 0x3c: case 0x3d: case 0x3f: 
-        {
-            return &SRL_R;
-        }
-        case 0x3e: 
-        {
-            return &SRL_DEREF_HL;
-        }
-        case 0x40: case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x47:
-        case 0x48: case 0x49: case 0x4a: case 0x4b: case 0x4c: case 0x4d: case 0x4f: 
-        case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x57:
-        case 0x58: case 0x59: case 0x5a: case 0x5b: case 0x5c: case 0x5d: case 0x5f: 
-        case 0x60: case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x67:
-        case 0x68: case 0x69: case 0x6a: case 0x6b: case 0x6c: case 0x6d: case 0x6f:
-        case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x77:
-        case 0x78: case 0x79: case 0x7a: case 0x7b: case 0x7c: case 0x7d: case 0x7f:
-        {
-            return &BIT_B_R;
-        }
-        case 0x46: case 0x4e:
-        case 0x56: case 0x5e:
-        case 0x66: case 0x6e:
-        case 0x76: case 0x7e: {
-            return &BIT_B_DEREF_HL;
-        }
-        case 0x80: case 0x81: case 0x82: case 0x83: case 0x84: case 0x85: case 0x87:
-        case 0x88: case 0x89: case 0x8a: case 0x8b: case 0x8c: case 0x8d: case 0x8f: 
-        case 0x90: case 0x91: case 0x92: case 0x93: case 0x94: case 0x95: case 0x97:
-        case 0x98: case 0x99: case 0x9a: case 0x9b: case 0x9c: case 0x9d: case 0x9f: 
-        case 0xa0: case 0xa1: case 0xa2: case 0xa3: case 0xa4: case 0xa5: case 0xa7:
-        case 0xa8: case 0xa9: case 0xaa: case 0xab: case 0xac: case 0xad: case 0xaf:
-        case 0xb0: case 0xb1: case 0xb2: case 0xb3: case 0xb4: case 0xb5: case 0xb7:
-        case 0xb8: case 0xb9: case 0xba: case 0xbb: case 0xbc: case 0xbd: case 0xbf:
-        {
-            return &RES_B_R;
-        }
-        case 0x86: case 0x8e: 
-        case 0x96: case 0x9e: 
-        case 0xa6: case 0xae: 
-        case 0xb6: case 0xbe: 
-        {
-            return &RES_B_DEREF_HL;
-        }
-        case 0xc0: case 0xc1: case 0xc2: case 0xc3: case 0xc4: case 0xc5: case 0xc7:
-        case 0xc8: case 0xc9: case 0xca: case 0xcb: case 0xcc: case 0xcd: case 0xcf: 
-        case 0xd0: case 0xd1: case 0xd2: case 0xd3: case 0xd4: case 0xd5: case 0xd7:
-        case 0xd8: case 0xd9: case 0xda: case 0xdb: case 0xdc: case 0xdd: case 0xdf: 
-        case 0xe0: case 0xe1: case 0xe2: case 0xe3: case 0xe4: case 0xe5: case 0xe7:
-        case 0xe8: case 0xe9: case 0xea: case 0xeb: case 0xec: case 0xed: case 0xef:
-        case 0xf0: case 0xf1: case 0xf2: case 0xf3: case 0xf4: case 0xf5: case 0xf7:
-        case 0xf8: case 0xf9: case 0xfa: case 0xfb: case 0xfc: case 0xfd: case 0xff:
-        {
-            return &SET_B_R;
-        }
-        case 0xc6: case 0xce: 
-        case 0xd6: case 0xde: 
-        case 0xe6: case 0xee: 
-        case 0xf6: case 0xfe: 
-        {
-            return &SET_B_DEREF_HL;
-        }
-        default:
-            set_decoded_instruction("UNK");
-            return NULL;
-            /* clang-format on */
+const opcode_info_t *fetch_instruction(void) {
+    const opcode_info_t *opcode_info;
+    uint8_t *instruction = get_instruction();
+    clear_instruction();
+    append_instruction(0);
+    if (instruction[0] == 0xCB) {
+        append_instruction(1);
+        return &prefixed_opcodes[instruction[1]];
+    }
+    opcode_info = &unprefixed_opcodes[instruction[0]];
+    for (uint8_t i = 1; i < opcode_info->length; i++) {
+        append_instruction(i);
     }
+    return opcode_info;
 }
-static clock_cycles_t (
-    *decode_unprefixed_instruction(uint8_t instruction[MAX_INSTRUCTION_SIZE]))(
-    uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
-    const uint8_t OPCODE = instruction[0];
-    switch (OPCODE) {
-            /* clang-format off */
-        case 0x40: case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x47:
-        case 0x48: case 0x49: case 0x4a: case 0x4b: case 0x4c: case 0x4d: case 0x4f:
-        case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x57:
-        case 0x58: case 0x59: case 0x5a: case 0x5b: case 0x5c: case 0x5d: case 0x5f:
-        case 0x60: case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x67:
-        case 0x68: case 0x69: case 0x6a: case 0x6b: case 0x6c: case 0x6d: case 0x6f:
-        case 0x78: case 0x79: case 0x7a: case 0x7b: case 0x7c: case 0x7d: case 0x7f:
-            /* clang-format on */
-            { return &LD_RR; }
-        case 0xA8:
-        case 0xA9:
-        case 0xAA:
-        case 0xAB:
-        case 0xAC:
-        case 0xAD:
-        case 0xAF: {
-            return &XOR_A_R;
-        }
-        case 0xAE: {
-            return &XOR_A_DEREF_HL;
-        }
-        case 0x70:
-        case 0x71:
-        case 0x72:
-        case 0x73:
-        case 0x74:
-        case 0x75:
-        case 0x77: {
-            return &LD_ADDR_HL_R;
-        }
-        case 0x80:
-        case 0x81:
-        case 0x82:
-        case 0x83:
-        case 0x84:
-        case 0x85:
-        case 0x87: {
-            return &ADD_A_R;
-        }
-        case 0x86: {
-            return &ADD_A_DEREF_HL;
-        }
-        case 0xA0:
-        case 0xA1:
-        case 0xA2:
-        case 0xA3:
-        case 0xA4:
-        case 0xA5:
-        case 0xA7: {
-            return &AND_A_R;
-        }
-        case 0xA6: {
-            return &AND_A_DEREF_HL;
-        }
-        case 0x06:
-        case 0x16:
-        case 0x26:
-        case 0x0E:
-        case 0x1E:
-        case 0x2E:
-        case 0x3E: {
-            append_instruction(1);
-            return &LD_R_IMM;
-        }
-        case 0x04:
-        case 0x14:
-        case 0x24:
-        case 0x0C:
-        case 0x1C:
-        case 0x2C:
-        case 0x3C: {
-            return &INC_R;
-        }
-
-        case 0x05:
-        case 0x15:
-        case 0x25:
-        case 0x0D:
-        case 0x1D:
-        case 0x2D:
-        case 0x3D: {
-            return &DEC_R;
-        }
-        case 0x90:
-        case 0x91:
-        case 0x92:
-        case 0x93:
-        case 0x94:
-        case 0x95:
-        case 0x97: {
-            return &SUB_A_R;
-        }
-        case 0x46:
-        case 0x56:
-        case 0x66:
-        case 0x4E:
-        case 0x5E:
-        case 0x6E:
-        case 0x7E: {
-            return &LD_R_DEREF_HL;
-        }
-        case 0x88:
-        case 0x89:
-        case 0x8A:
-        case 0x8B:
-        case 0x8C:
-        case 0x8D:
-        case 0x8F: {
-            return &ADC_A_R;
-        }
-        case 0x98:
-        case 0x99:
-        case 0x9A:
-        case 0x9B:
-        case 0x9C:
-        case 0x9D:
-        case 0x9F: {
-            return &SBC_A_R;
-        }
-        case 0xB8:
-        case 0xB9:
-        case 0xBA:
-        case 0xBB:
-        case 0xBC:
-        case 0xBD:
-        case 0xBF: {
-            return &CP_A_R;
-        }
-        case 0x0a:
-        case 0x1a: {
-            return &LD_A_DEREF_LONG_R;
-        }
-        case 0x2a: {
-            return &LD_A_DEREF_HL_INC;
-        }
-        case 0x3a: {
-            return &LD_A_DEREF_HL_DEC;
-        }
-        case 0x02:
-        case 0x12: {
-            return &LD_ADDR_LONG_R_A;
-        }
-        case 0x22: {
-
-            return &LD_ADDR_HL_INC_A;
-        }
-        case 0x32: {
-            return &LD_ADDR_HL_DEC_A;
-        }
-        case 0x20: {
-            append_instruction(1);
-            return &JR_NZ_IMM;
-        }
-        case 0x30: {
-            append_instruction(1);
-            return &JR_NC_IMM;
-        }
-        case 0xE0: {
-            append_instruction(1);
-            return &LD_ADDR_FF00_PLUS_IMM_REGISTER_A;
-        }
-        case 0xE2: {
-            return &LD_DEREF_FF00_PLUS_C_A;
-        }
-        case 0x07: {
-            return &RLCA;
-        }
-        case 0x0F: {
-            return &RRCA;
-        }
-        case 0x10: {
-            return &STOP;
-        }
-        case 0x09:
-        case 0x19:
-        case 0x29: {
-            return &ADD_HL_LONG_R;
-        }
-        case 0x39: {
-            return &ADD_HL_SP;
-        }
-        case 0x1F: {
-            return &RRA;
-        }
-
-        case 0x27: {
-            return &DAA;
-        }
 
-        case 0x2f: {
-            return &CPL;
-        }
-
-        case 0x34: {
-            return &INC_DEREF_HL;
-        }
-
-        case 0x35: {
-            return &DEC_DEREF_HL;
-        }
-        case 0x36: {
-            append_instruction(1);
-            return &LD_ADDR_HL_IMM;
-        }
-        case 0x37: {
-            return &SCF;
-        }
-        case 0x38: {
-            append_instruction(1);
-            return &JR_C_IMM;
-        }
-        case 0x3f: {
-            return &CCF;
-        }
-        case 0x76: {
-            return &HALT;
-        }
-        case 0x8e: {
-            return &ADC_A_DEREF_HL;
-        }
-        case 0x96: {
-            return &SUB_A_DEREF_HL;
-        }
-        case 0x9e: {
-            return &SBC_A_DEREF_HL;
-        }
-        case 0xb0:
-        case 0xb1:
-        case 0xb2:
-        case 0xb3:
-        case 0xb4:
-        case 0xb5:
-        case 0xb7: {
-            return &OR_A_R;
-        }
-        case 0xb6: {
-            return &OR_A_DEREF_HL;
-        }
-        case 0xc0: {
-            return &RET_NZ;
-        }
-        case 0xc4: {
-            append_instruction(1);
-            append_instruction(2);
-            return &CALL_NZ_IMM;
-        }
-        case 0xc6: {
-            append_instruction(1);
-            return &ADD_A_IMM;
-        }
-        case 0xC7:
-        case 0xD7:
-        case 0xE7:
-        case 0xF7: {
-            return &RST_x0h;
-        }
-        case 0xc8: {
-            return &RET_Z;
-        }
-        case 0xd8: {
-            return &RET_C;
-        }
-        case 0xCA: {
-            append_instruction(1);
-            append_instruction(2);
-            return &JP_Z_IMM;
-        }
-        case 0xDA: {
-            append_instruction(1);
-            append_instruction(2);
-            return &JP_C_IMM;
-        }
-        case 0xCF:
-        case 0xDF:
-        case 0xEF:
-        case 0xFF: {
-            return &RST_x8h;
-        }
-        case 0xD0: {
-            return &RET_NC;
-        }
-        case 0xD4: {
-            append_instruction(1);
-            append_instruction(2);
-            return &CALL_NC_IMM;
-        }
-        case 0xD6: {
-            append_instruction(1);
-            return &SUB_A_IMM;
-        }
-        case 0xDC: {
-            append_instruction(1);
-            append_instruction(2);
-            return &CALL_C_IMM;
-        }
-        case 0xDE: {
-            append_instruction(1);
-            return &SBC_A_IMM;
-        }
-        case 0xE6: {
-            append_instruction(1);
-            return &AND_A_IMM;
-        }
-        case 0xE8: {
-            append_instruction(1);
-            return &ADD_SP_IMM;
-        }
-        case 0xE9: {
-            return &JP_HL;
-        }
-        case 0xEE: {
-            append_instruction(1);
-            return &XOR_A_IMM;
-        }
-        case 0xF2: {
-            return &LD_A_DEREF_FF00_PLUS_C;
-        }
-        case 0xF3: {
-            return &DI;
-        }
-        case 0xF6: {
-            append_instruction(1);
-            return &OR_A_IMM;
-        }
-        case 0xF8: {
-            append_instruction(1);
-            return &LD_HL_SP_PLUS_IMM;
-        }
-        case 0xF9: {
-            return &LD_SP_HL;
-        }
-        case 0xFA: {
-            append_instruction(1);
-            append_instruction(2);
-            return &LD_A_DEREF_IMM;
-        }
-        case 0xFB: {
-            return &EI;
-        }
-        case 0x01:
-        case 0x11:
-        case 0x21: {
-            append_instruction(1);
-            append_instruction(2);
-
-            return &LD_LONG_R_IMM;
-        }
-        case 0x31: {
-            append_instruction(1);
-            append_instruction(2);
-
-            return &LD_SP_IMM;
-        }
-        case 0x03:
-        case 0x13:
-        case 0x23: {
-            return &INC_LONG_R;
-        }
-        case 0x33: {
-            return &INC_SP;
-        }
-        case 0x0B:
-        case 0x1B:
-        case 0x2B: {
-            return &DEC_LONG_R;
-        }
-        case 0x3B: {
-            return &DEC_SP;
-        }
-        case 0xc5:
-        case 0xd5:
-        case 0xe5: {
-            return &PUSH_LONG_R;
-        }
-        case 0xF5: {
-            return &PUSH_AF;
-        }
-        case 0xc1:
-        case 0xd1:
-        case 0xe1: {
-            return &POP_LONG_R;
-        }
-        case 0xf1: {
-            return &POP_LONG_AF;
-        }
-
-        case 0xFE: {
-            append_instruction(1);
-            return &CP_A_IMM;
-        }
-
-        case 0xCD: {
-            append_instruction(1);
-            append_instruction(2);
-
-            return &CALL_IMM;
-        }
-
-        case 0xEA: {
-            append_instruction(1);
-            append_instruction(2);
-
-            return &LD_ADDR_IMM_A;
-        }
-        case 0x18: {
-            append_instruction(1);
-            return &JR_IMM;
-        }
-        case 0x28: {
-            append_instruction(1);
-            return &JR_Z_IMM;
-        }
-        case 0xF0: {
-            append_instruction(1);
-            return &LD_A_DEREF_FF00_PLUS_IMM;
-        }
-        case 0xBE: {
-            return &CP_A_DEREF_HL;
-        }
-        case 0x17: {
-            return &RLA;
-        }
-        case 0xCE: {
-            append_instruction(1);
-            return &ADC_A_IMM;
-        }
-        case 0xc9: {
-            return &RET;
-        }
-        case 0xd9: {
-            return &RETI;
-        }
-        case 0xCC: {
-            append_instruction(1);
-            append_instruction(2);
-            return &CALL_Z_IMM;
-        }
-        case 0x08: {
-            append_instruction(1);
-            append_instruction(2);
-            return &LD_ADDR_IMM_SP;
-        }
-        case 0xc2: {
-            append_instruction(1);
-            append_instruction(2);
-            return &JP_NZ_IMM;
-        }
-        case 0xD2: {
-            append_instruction(1);
-            append_instruction(2);
-            return &JP_NC_IMM;
-        }
-        case 0xc3: {
-            append_instruction(1);
-            append_instruction(2);
-            return &JP_IMM;
-        }
-        case 0x00: {
-            return &NOP;
-        }
-        case 0xDB:
-        case 0xDD:
-        case 0xD3:
-        case 0xE3:
-        case 0xE4:
-        case 0xEB:
-        case 0xEC:
-        case 0xED:
-        case 0xF4:
-        case 0xFC:
-        case 0xFD: {
-
-            set_decoded_instruction("INVALID");
-            return &UNK;
-        }
-        default: set_decoded_instruction("UNK"); return &UNK;
+clock_cycles_t execute_instruction(const opcode_info_t *opcode_info) {
+    inc_instruction_count();
+    clock_cycles_t clocks = opcode_info->execute(get_instruction());
+    if (clocks >= 0) {
+        return clocks;
     }
+    set_is_implemented(false);
+    return -1;
 }
@@ -1,36 +1,122 @@
 #include "SDL_events.h"
 #include "SDL_scancode.h"
-#include "cpu.h"
+#include "context.h"
 #include "debug.h"
-#include "decoder.h"
+#include "gbcore.h"
 #include "graphics.h"
 #include "hardware.h"
-#include "memory.h"
-#include "ppu.h"
+#include "idle_loop.h"
+#include "jit.h"
+#include "tile_cache.h"
 #include <getopt.h>
 #include <ncurses.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
-uint64_t instructions_left = 0;
+#define SAVE_DIR "saves"
+
 void main_loop(void);
-void cleanup(void);
+
+static gb_core_t *core;
+// Written by the window's thread, read by the emulation thread
+static atomic_bool close_cpu = false;
+static atomic_bool step_mode = false;
+static _Atomic uint64_t instructions_left = 0;
+static _Atomic uint8_t held_buttons = 0;
+
+// NULL when built to skip the boot ROM
+static const uint8_t *read_boot_rom(void) {
+#ifdef SKIP_BOOT
+    return NULL;
+#endif
+    static uint8_t boot_rom[GB_BOOT_ROM_SIZE];
+    FILE *dmg_file = fopen("dmg.bin", "r");
+    if (!dmg_file) {
+        fprintf(stderr, "No dmg present\n");
+        exit(1);
+    }
+    unsigned long bytes_read = fread(boot_rom, GB_BOOT_ROM_SIZE, 1, dmg_file);
+    if (bytes_read != 1) {
+        fprintf(stderr, "Unable To Read DMG, %d\n", (int)bytes_read);
+        exit(1);
+    }
+    fclose(dmg_file);
+    return boot_rom;
+}
+
+static void load_game(const char *path) {
+    FILE *game = fopen(path, "r");
+    if (!game) {
+        fprintf(stderr, "ROM does not exist\n");
+        exit(1);
+    }
+    fseek(game, 0, SEEK_END);
+    const long SIZE = ftell(game);
+    rewind(game);
+    uint8_t *rom = SIZE > 0 ? malloc((size_t)SIZE) : NULL;
+    if (!rom || fread(rom, (size_t)SIZE, 1, game) != 1) {
+        fprintf(stderr, "Unable to read ROM\n");
+        exit(1);
+    }
+    fclose(game);
+    const uint8_t *boot_rom = read_boot_rom();
+    if ((boot_rom && !gb_load_boot_rom(core, boot_rom, GB_BOOT_ROM_SIZE)) ||
+        !gb_set_save_directory(core, SAVE_DIR) ||
+        !gb_load_rom(core, rom, (size_t)SIZE)) {
+        exit(1);
+    }
+    free(rom);
+    update_window_title(gb_get_cartridge_title(core));
+}
+
+/*
+ * Runs the core a frame at a time, handing it the buttons held at the start of
+ * each one. After an unimplemented instruction, or while the debugger asks for
+ * it, instructions only run when stepped through.
+ */
+static void *run_cpu(void *arg) {
+    (void)arg;
+    while (!atomic_load(&close_cpu)) {
+        gb_set_joypad(core, atomic_load(&held_buttons));
+        if (!atomic_load(&step_mode)) {
+            if (!gb_run_frames(core, 1)) {
+                atomic_store(&step_mode, true);
+            }
+        } else if (atomic_load(&instructions_left) > 0) {
+            atomic_fetch_sub(&instructions_left, 1);
+            gb_step(core);
+        }
+    }
+    return NULL;
+}
 
 int main(int argc, char **argv) {
     pthread_t cpu_id;
-    FILE *game;
     int long_index = 0;
     int opt = 0;
+    bool render_thread = false;
+    enum GB_CPU_MODE cpu_mode = GB_CPU_INTERPRETER;
+    enum GB_RENDERER renderer = GB_RENDERER_SCANLINE;
     static struct option program_options[] = {
-        {"game", required_argument, 0, 'g'}, {0, 0, 0, 0}};
+        {"game", required_argument, 0, 'g'},
+        {"cpu", required_argument, 0, 'c'},
+        {"renderer", required_argument, 0, 'r'},
+        {"frame-skip", required_argument, 0, 's'},
+        {"render-thread", no_argument, 0, 't'},
+        {0, 0, 0, 0}};
 
     open_window();
-    initialize_hardware();
-    initialize_ppu();
-    initialize_io();
-    while ((opt = getopt_long(argc, argv, "g:", program_options,
+    // Also makes the core's context this thread's, which the window reads
+    core = gb_create();
+    if (!core) {
+        fprintf(stderr, "Unable to allocate memory for emulator context\n");
+        exit(1);
+    }
+    while ((opt = getopt_long(argc, argv, "g:c:r:s:t", program_options,
                               &long_index)) != -1) {
         switch (opt) {
             case 'g':
@@ -38,24 +124,64 @@ int main(int argc, char **argv) {
                     fprintf(stderr, "Must provide ROM path\n");
                     exit(1);
                 }
-                game = fopen(optarg, "r");
-                if (!game) {
-                    fprintf(stderr, "ROM does not exist\n");
+                load_game(optarg);
+                break;
+            case 'c':
+                if (strcmp(optarg, "interpreter") == 0) {
+                    cpu_mode = GB_CPU_INTERPRETER;
+                } else if (strcmp(optarg, "cached") == 0) {
+                    cpu_mode = GB_CPU_CACHED;
+                } else if (strcmp(optarg, "jit") == 0) {
+                    cpu_mode = GB_CPU_JIT;
+                } else {
+                    fprintf(stderr, "Unknown CPU mode: %s\n", optarg);
+                    exit(1);
+                }
+                if (!gb_set_cpu_mode(core, cpu_mode)) {
+                    fprintf(stderr, "JIT is not supported on this platform, "
+                                    "using cached mode\n");
+                    cpu_mode = GB_CPU_CACHED;
+                }
+                break;
+            case 'r':
+                if (strcmp(optarg, "scanline") == 0) {
+                    renderer = GB_RENDERER_SCANLINE;
+                } else if (strcmp(optarg, "pixel") == 0) {
+                    renderer = GB_RENDERER_PIXEL;
+                } else {
+                    fprintf(stderr, "Unknown renderer: %s\n", optarg);
                     exit(1);
                 }
-                load_rom(game);
-                fclose(game);
+                gb_set_renderer(core, renderer);
                 break;
+            case 's':
+                if (strcmp(optarg, "auto") == 0) {
+                    gb_set_adaptive_frame_skip(core, true);
+                } else {
+                    char *end;
+                    const long FRAMES = strtol(optarg, &end, 10);
+                    if (*end != '\0' || FRAMES < 1 || FRAMES > UINT8_MAX) {
+                        fprintf(stderr, "Invalid frame skip: %s\n", optarg);
+                        exit(1);
+                    }
+                    gb_set_frame_skip(core, (uint8_t)FRAMES);
+                }
+                break;
+            case 't': render_thread = true; break;
             default: exit(1); break;
         }
     }
-    atexit(&cleanup);
+    if (render_thread && !gb_set_render_thread(core, true)) {
+        fprintf(stderr, "Unable to start the render thread\n");
+        exit(1);
+    }
+    gb_set_real_time(core, true);
 
 #ifdef ENABLE_DEBUGGER
     pthread_t debugger_id;
-    pthread_create(&debugger_id, NULL, initialize_debugger, NULL);
+    pthread_create(&debugger_id, NULL, initialize_debugger, gb);
 #endif
-    pthread_create(&cpu_id, NULL, start_cpu, NULL);
+    pthread_create(&cpu_id, NULL, run_cpu, NULL);
     main_loop();
     close_window();
 
@@ -63,16 +189,29 @@ int main(int argc, char **argv) {
     end_debugger();
     pthread_join(debugger_id, NULL);
 #endif
-    end_ppu();
-    end_cpu();
+    atomic_store(&close_cpu, true);
     pthread_join(cpu_id, NULL);
-    save_data();
+    gb_set_render_thread(core, false);
+    if (cpu_mode == GB_CPU_JIT) {
+        print_jit_stats();
+    }
+    if (cpu_mode != GB_CPU_INTERPRETER) {
+        print_idle_loop_stats();
+    }
+    if (renderer == GB_RENDERER_SCANLINE) {
+        print_tile_cache_stats();
+    }
+    // Writes back battery backed RAM
+    gb_destroy(core);
     return 0;
 }
 
-void cleanup(void) {
-    destroy_memory();
-    destroy_hardware();
+static void press_button(uint8_t button) {
+    atomic_fetch_or(&held_buttons, button);
+}
+
+static void release_button(uint8_t button) {
+    atomic_fetch_and(&held_buttons, (uint8_t)~button);
 }
 
 void main_loop(void) {
@@ -82,45 +221,78 @@ void main_loop(void) {
         while (SDL_PollEvent(&e)) {
             switch (e.type) {
                 case SDL_QUIT: end_main_loop = true; break;
+                case SDL_WINDOWEVENT:
+                    if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                        redraw_window();
+                    }
+                    break;
                 case SDL_KEYDOWN:
                     switch (e.key.keysym.scancode) {
-                        case SDL_SCANCODE_N: instructions_left += 1; break;
-                        case SDL_SCANCODE_M: instructions_left += 100; break;
-                        case SDL_SCANCODE_B: instructions_left += 1000; break;
+                        case SDL_SCANCODE_N:
+                            atomic_fetch_add(&instructions_left, 1);
+                            break;
+                        case SDL_SCANCODE_M:
+                            atomic_fetch_add(&instructions_left, 100);
+                            break;
+                        case SDL_SCANCODE_B:
+                            atomic_fetch_add(&instructions_left, 1000);
+                            break;
 #ifdef ENABLE_DEBUGGER
-                        case SDL_SCANCODE_O: toggle_step_mode(); break;
+                        case SDL_SCANCODE_O:
+                            atomic_store(&step_mode, !atomic_load(&step_mode));
+                            break;
 #endif
-                        case SDL_SCANCODE_W: reset_joypad_state(UP); break;
-                        case SDL_SCANCODE_A: reset_joypad_state(LEFT); break;
-                        case SDL_SCANCODE_S: reset_joypad_state(DOWN); break;
-                        case SDL_SCANCODE_D: reset_joypad_state(RIGHT); break;
-                        case SDL_SCANCODE_J:
-                            reset_joypad_state(A_BUTTON);
+                        case SDL_SCANCODE_W: press_button(GB_BUTTON_UP); break;
+                        case SDL_SCANCODE_A:
+                            press_button(GB_BUTTON_LEFT);
+                            break;
+                        case SDL_SCANCODE_S:
+                            press_button(GB_BUTTON_DOWN);
                             break;
-                        case SDL_SCANCODE_K:
-                            reset_joypad_state(B_BUTTON);
+                        case SDL_SCANCODE_D:
+                            press_button(GB_BUTTON_RIGHT);
+                            break;
+                        case SDL_SCANCODE_J: press_button(GB_BUTTON_A); break;
+                        case SDL_SCANCODE_K: press_button(GB_BUTTON_B); break;
+                        case SDL_SCANCODE_C:
+                            press_button(GB_BUTTON_SELECT);
+                            break;
+                        case SDL_SCANCODE_V:
+                            press_button(GB_BUTTON_START);
                             break;
-                        case SDL_SCANCODE_C: reset_joypad_state(SELECT); break;
-                        case SDL_SCANCODE_V: reset_joypad_state(START); break;
                         default: break;
                     }
                     break;
                 case SDL_KEYUP:
                     switch (e.key.keysym.scancode) {
-                        case SDL_SCANCODE_W: set_joypad_state(UP); break;
-                        case SDL_SCANCODE_A: set_joypad_state(LEFT); break;
-                        case SDL_SCANCODE_S: set_joypad_state(DOWN); break;
-                        case SDL_SCANCODE_D: set_joypad_state(RIGHT); break;
-                        case SDL_SCANCODE_J: set_joypad_state(A_BUTTON); break;
-                        case SDL_SCANCODE_K: set_joypad_state(B_BUTTON); break;
-                        case SDL_SCANCODE_C: set_joypad_state(SELECT); break;
-                        case SDL_SCANCODE_V: set_joypad_state(START); break;
+                        case SDL_SCANCODE_W:
+                            release_button(GB_BUTTON_UP);
+                            break;
+                        case SDL_SCANCODE_A:
+                            release_button(GB_BUTTON_LEFT);
+                            break;
+                        case SDL_SCANCODE_S:
+                            release_button(GB_BUTTON_DOWN);
+                            break;
+                        case SDL_SCANCODE_D:
+                            release_button(GB_BUTTON_RIGHT);
+                            break;
+                        case SDL_SCANCODE_J: release_button(GB_BUTTON_A); break;
+                        case SDL_SCANCODE_K: release_button(GB_BUTTON_B); break;
+                        case SDL_SCANCODE_C:
+                            release_button(GB_BUTTON_SELECT);
+                            break;
+                        case SDL_SCANCODE_V:
+                            release_button(GB_BUTTON_START);
+                            break;
                         default: break;
                     }
                     break;
             }
         }
-        if (ppu.ready_to_render) {
+        // Frames are published by the CPU thread, or the render worker a while
+        // after the CPU finished them, and picked up as soon as they're there
+        if (is_new_frame_ready()) {
             update_renderer();
         }
     }
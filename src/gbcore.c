@@ -0,0 +1,273 @@
+#include "gbcore.h"
+#include "block_cache.h"
+#include "context.h"
+#include "cpu.h"
+#include "frame_conversion.h"
+#include "hardware.h"
+#include "idle_loop.h"
+#include "jit.h"
+#include "memory.h"
+#include "ppu.h"
+#include "render_worker.h"
+#include "scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CARTRIDGE_HEADER_END 0x150
+#define CYCLES_PER_LCD_FRAME (SCAN_LINES * 456)
+
+struct GameboyCore {
+    gameboy_context_t *context;
+    uint32_t *framebuffer;
+    bool rom_loaded;
+    bool has_boot_rom;
+    uint8_t boot_rom[GB_BOOT_ROM_SIZE];
+    char *save_directory;
+};
+
+gb_core_t *gb_create(void) {
+    gb_core_t *core = calloc(1, sizeof(gb_core_t));
+    if (!core) {
+        return NULL;
+    }
+    core->framebuffer =
+        calloc(GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT, sizeof(uint32_t));
+    if (!core->framebuffer) {
+        free(core);
+        return NULL;
+    }
+    core->context = create_context();
+    if (!core->context || !initialize_hardware()) {
+        destroy_context(core->context);
+        free(core->framebuffer);
+        free(core);
+        return NULL;
+    }
+    initialize_ppu();
+    initialize_scheduler();
+    initialize_io();
+    set_cpu_throttle(false);
+    return core;
+}
+
+void gb_destroy(gb_core_t *core) {
+    if (!core) {
+        return;
+    }
+    set_context(core->context);
+    stop_render_worker();
+    if (core->rom_loaded) {
+        save_data();
+    }
+    destroy_jit();
+    destroy_block_cache();
+    destroy_memory();
+    destroy_hardware();
+    destroy_context(core->context);
+    free(core->save_directory);
+    free(core->framebuffer);
+    free(core);
+}
+
+bool gb_load_boot_rom(gb_core_t *core, const uint8_t *boot_rom, size_t size) {
+    if (core->rom_loaded || size != GB_BOOT_ROM_SIZE) {
+        return false;
+    }
+    memcpy(core->boot_rom, boot_rom, GB_BOOT_ROM_SIZE);
+    core->has_boot_rom = true;
+    return true;
+}
+
+bool gb_set_save_directory(gb_core_t *core, const char *directory) {
+    if (core->rom_loaded || strlen(directory) >= MAX_SAVE_DATA_NAME_SIZE) {
+        return false;
+    }
+    char *copy = strdup(directory);
+    if (!copy) {
+        return false;
+    }
+    free(core->save_directory);
+    core->save_directory = copy;
+    return true;
+}
+
+bool gb_load_rom(gb_core_t *core, const uint8_t *rom, size_t size) {
+    set_context(core->context);
+    if (core->rom_loaded || size < CARTRIDGE_HEADER_END) {
+        return false;
+    }
+    FILE *rom_stream = fmemopen((void *)rom, size, "r");
+    if (!rom_stream) {
+        return false;
+    }
+    core->rom_loaded =
+        load_rom(rom_stream, core->has_boot_rom ? core->boot_rom : NULL,
+                 core->save_directory);
+    fclose(rom_stream);
+    return core->rom_loaded;
+}
+
+bool gb_run_cycles(gb_core_t *core, uint64_t cycles) {
+    set_context(core->context);
+    if (!core->rom_loaded) {
+        return false;
+    }
+    const uint64_t TARGET = get_cycles() + cycles;
+    while (get_cycles() < TARGET) {
+        if (!get_is_implemented()) {
+            return false;
+        }
+        step_cpu();
+    }
+    return get_is_implemented();
+}
+
+bool gb_run_frames(gb_core_t *core, uint32_t frames) {
+    set_context(core->context);
+    if (!core->rom_loaded) {
+        return false;
+    }
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        const uint64_t TARGET = get_cycles() + CYCLES_PER_LCD_FRAME;
+        gb->ppu.ready_to_render = false;
+        while (!gb->ppu.ready_to_render && get_cycles() < TARGET) {
+            if (!get_is_implemented()) {
+                return false;
+            }
+            step_cpu();
+        }
+    }
+    return get_is_implemented();
+}
+
+uint64_t gb_get_cycles(const gb_core_t *core) {
+    set_context(core->context);
+    return get_cycles();
+}
+
+bool gb_step(gb_core_t *core) {
+    set_context(core->context);
+    if (!core->rom_loaded || !get_is_implemented()) {
+        return false;
+    }
+    gb->cpu.step_mode = true;
+    step_cpu();
+    gb->cpu.step_mode = false;
+    return get_is_implemented();
+}
+
+void gb_set_real_time(gb_core_t *core, bool enabled) {
+    set_context(core->context);
+    set_cpu_throttle(enabled);
+}
+
+const char *gb_get_cartridge_title(const gb_core_t *core) {
+    set_context(core->context);
+    return get_cartridge_title();
+}
+
+void gb_set_joypad(gb_core_t *core, uint8_t buttons) {
+    set_context(core->context);
+    for (uint8_t button = RIGHT; button <= START; button++) {
+        const bool HELD = (buttons >> button) & 1;
+        // Inputs are active low, only a new press raises the interrupt
+        const bool WAS_HELD = !((get_joypad_state() >> button) & 1);
+        if (HELD && !WAS_HELD) {
+            reset_joypad_state((joypad_t)button);
+        } else if (!HELD && WAS_HELD) {
+            set_joypad_state((joypad_t)button);
+        }
+    }
+}
+
+bool gb_set_cpu_mode(gb_core_t *core, enum GB_CPU_MODE mode) {
+    set_context(core->context);
+    invalidate_block_cursor();
+    switch (mode) {
+        case GB_CPU_INTERPRETER: set_cpu_mode(INTERPRETER); return true;
+        case GB_CPU_CACHED: set_cpu_mode(BLOCK_CACHE); return true;
+        case GB_CPU_JIT:
+            if (initialize_jit()) {
+                set_cpu_mode(JIT);
+                return true;
+            }
+            set_cpu_mode(BLOCK_CACHE);
+            return false;
+    }
+    return false;
+}
+
+gb_idle_loop_stats_t gb_get_idle_loop_stats(const gb_core_t *core) {
+    set_context(core->context);
+    const idle_loop_stats_t STATS = get_idle_loop_stats();
+    return (gb_idle_loop_stats_t){STATS.skips, STATS.skipped_iterations,
+                                  STATS.skipped_cycles};
+}
+
+gb_jit_stats_t gb_get_jit_stats(const gb_core_t *core) {
+    set_context(core->context);
+    const jit_stats_t STATS = get_jit_stats();
+    return (gb_jit_stats_t){STATS.blocks_compiled, STATS.block_hits,
+                            STATS.native_instructions, STATS.early_exits,
+                            STATS.deadline_fallbacks, STATS.compile_failures};
+}
+
+void gb_set_frame_skip(gb_core_t *core, uint8_t frames) {
+    set_context(core->context);
+    set_frame_skip(frames);
+}
+
+void gb_set_adaptive_frame_skip(gb_core_t *core, bool enabled) {
+    set_context(core->context);
+    set_adaptive_frame_skip(enabled);
+}
+
+void gb_set_renderer(gb_core_t *core, enum GB_RENDERER renderer) {
+    set_context(core->context);
+    switch (renderer) {
+        case GB_RENDERER_SCANLINE: set_ppu_renderer(SCANLINE_RENDERER); return;
+        case GB_RENDERER_PIXEL: set_ppu_renderer(PIXEL_RENDERER); return;
+    }
+}
+
+bool gb_set_render_thread(gb_core_t *core, bool enabled) {
+    set_context(core->context);
+    if (!enabled) {
+        stop_render_worker();
+        return true;
+    }
+    if (gb->ppu.render_worker) {
+        return true;
+    }
+    return core->rom_loaded && start_render_worker();
+}
+
+const uint8_t *gb_get_indexed_framebuffer(const gb_core_t *core) {
+    set_context(core->context);
+    flush_render_worker();
+    return get_latest_frame();
+}
+
+void gb_convert_framebuffer(const gb_core_t *core, enum GB_PIXEL_FORMAT format,
+                            void *pixels, size_t pitch) {
+    set_context(core->context);
+    flush_render_worker();
+    switch (format) {
+        case GB_PIXEL_RGBA8888:
+            convert_frame(get_latest_frame(), FRAME_RGBA8888, pixels, pitch);
+            return;
+        case GB_PIXEL_RGB565:
+            convert_frame(get_latest_frame(), FRAME_RGB565, pixels, pitch);
+            return;
+        case GB_PIXEL_GRAY8:
+            convert_frame(get_latest_frame(), FRAME_GRAY8, pixels, pitch);
+            return;
+    }
+}
+
+const uint32_t *gb_get_framebuffer(const gb_core_t *core) {
+    gb_convert_framebuffer(core, GB_PIXEL_RGBA8888, core->framebuffer,
+                           GB_SCREEN_WIDTH * sizeof(uint32_t));
+    return core->framebuffer;
+}
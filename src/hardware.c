@@ -1,4 +1,6 @@
 #include "hardware.h"
+#include "context.h"
+#include "interrupts.h"
 #include "utils.h"
 #include <stdarg.h>
 #include <stdint.h>
@@ -6,72 +8,184 @@
 #include <stdlib.h>
 #include <string.h>
 
-static Hardware hardware;
 
 #define TRACER_SIZE 50
-
-void initialize_hardware(void) {
-    hardware.display_buffer =
-        calloc(DISPLAY_WIDTH * DISPLAY_HEIGHT, sizeof(uint32_t));
-    if (!(hardware.display_buffer)) {
-        fprintf(stderr, "Unable to allocate memory for display buff\n");
+#define FRAME_SIZE (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+#define FRAME_INDEX_MASK 0x03
+
+Hardware *get_hardware(void) { return &gb->hardware; }
+
+// Returns false if the display buffers can't be allocated
+bool initialize_hardware(void) {
+    DisplayBuffers *display_buffers = calloc(1, sizeof(DisplayBuffers));
+    uint8_t *frames = calloc(3 * FRAME_SIZE, sizeof(uint8_t));
+    if (!display_buffers || !frames) {
+        free(display_buffers);
+        free(frames);
+        return false;
     }
-    memset(hardware.registers, 0, REGISTER_COUNT);
-    hardware.is_implemented = true;
-    hardware.is_double_speed = false;
-    hardware.sp = 0;
-    hardware.pc = 0;
-    hardware.instruction_count = 0;
-    hardware.interrupt_state = NOTHING;
-    hardware.ime_flag = 0;
-    hardware.oam_dma_started = false;
-    hardware.base_sp = 0xFFFE;
-
-    // initial state after boot
-#ifdef SKIP_BOOT
-    hardware.registers[A] = 0x01;
-    hardware.registers[F] = 0xB0;
-    hardware.registers[B] = 0x00;
-    hardware.registers[C] = 0x13;
-    hardware.registers[D] = 0x00;
-    hardware.registers[E] = 0xD8;
-    hardware.registers[H] = 0x01;
-    hardware.registers[L] = 0x4D;
-    hardware.sp = 0xFFFE;
-    hardware.pc = 0x0100;
-#endif
+    for (uint8_t frame = 0; frame < 3; frame++) {
+        display_buffers->frames[frame] = &frames[frame * FRAME_SIZE];
+    }
+    display_buffers->back = 0;
+    atomic_init(&display_buffers->shared, 1);
+    display_buffers->front = 2;
+    gb->hardware.display_buffers = display_buffers;
+    memset(gb->hardware.registers, 0, REGISTER_COUNT);
+    gb->hardware.is_implemented = true;
+    gb->hardware.is_double_speed = false;
+    gb->hardware.sp = 0;
+    gb->hardware.pc = 0;
+    gb->hardware.instruction_count = 0;
+    gb->hardware.interrupt_state = NOTHING;
+    gb->hardware.ime_flag = 0;
+    gb->hardware.lazy_flags.operation = FLAGS_EVALUATED;
+    gb->hardware.oam_dma_started = false;
+    gb->hardware.base_sp = 0xFFFE;
+    return true;
+}
+
+// Leaves the registers as the boot ROM does when it jumps to the cartridge
+void skip_boot_rom(void) {
+    gb->hardware.registers[A] = 0x01;
+    gb->hardware.registers[F] = 0xB0;
+    gb->hardware.registers[B] = 0x00;
+    gb->hardware.registers[C] = 0x13;
+    gb->hardware.registers[D] = 0x00;
+    gb->hardware.registers[E] = 0xD8;
+    gb->hardware.registers[H] = 0x01;
+    gb->hardware.registers[L] = 0x4D;
+    gb->hardware.sp = 0xFFFE;
+    gb->hardware.pc = 0x0100;
 }
 
 void destroy_hardware(void) {
-    if (hardware.display_buffer) {
-        free(hardware.display_buffer);
-        hardware.display_buffer = NULL;
+    if (gb->hardware.display_buffers) {
+        free(gb->hardware.display_buffers->frames[0]);
+        free(gb->hardware.display_buffers);
+        gb->hardware.display_buffers = NULL;
     }
     return;
 }
 
+static inline uint8_t flag_bit(flags_t flag, bool val) {
+    return (uint8_t)(val << (7 - flag));
+}
+
+/*
+ * Works out F from the pending operation without storing it, so readers on
+ * other threads (the debugger) don't modify CPU state.
+ */
+static uint8_t evaluate_flags(void) {
+    const lazy_flags_t *flags = &gb->hardware.lazy_flags;
+    const uint8_t FLAGS_REGISTER = gb->hardware.registers[F];
+    const uint8_t VAL_1 = (uint8_t)flags->val_1;
+    const uint8_t VAL_2 = (uint8_t)flags->val_2;
+
+    switch (flags->operation) {
+        case FLAGS_ADD: {
+            uint16_t res = (uint16_t)(VAL_1 + VAL_2 + flags->carry);
+            return (FLAGS_REGISTER & 0x0F) |
+                   flag_bit(Z_FLAG, (res & 0xFF) == 0) |
+                   flag_bit(H_FLAG,
+                            half_carry_on_add(VAL_1, VAL_2, flags->carry)) |
+                   flag_bit(C_FLAG, res > UINT8_MAX);
+        }
+        case FLAGS_SUB: {
+            uint8_t res = (uint8_t)(VAL_1 - VAL_2 - flags->carry);
+            return (FLAGS_REGISTER & 0x0F) | flag_bit(Z_FLAG, res == 0) |
+                   flag_bit(N_FLAG, true) |
+                   flag_bit(H_FLAG, half_carry_on_subtract(VAL_1, VAL_2,
+                                                           flags->carry)) |
+                   flag_bit(C_FLAG, (VAL_2 + flags->carry) > VAL_1);
+        }
+        case FLAGS_ADD16: {
+            uint32_t res = flags->val_1 + flags->val_2;
+            return (FLAGS_REGISTER & 0x8F) |
+                   flag_bit(H_FLAG,
+                            half_carry_on_add16(flags->val_2, flags->val_1)) |
+                   flag_bit(C_FLAG, res > UINT16_MAX);
+        }
+        case FLAGS_INC:
+            return (FLAGS_REGISTER & 0x1F) |
+                   flag_bit(Z_FLAG, (uint8_t)(VAL_1 + 1) == 0) |
+                   flag_bit(H_FLAG, half_carry_on_add(VAL_1, 1, 0));
+        case FLAGS_DEC:
+            return (FLAGS_REGISTER & 0x1F) |
+                   flag_bit(Z_FLAG, (uint8_t)(VAL_1 - 1) == 0) |
+                   flag_bit(N_FLAG, true) |
+                   flag_bit(H_FLAG, half_carry_on_subtract(VAL_1, 1, 0));
+        case FLAGS_EVALUATED:
+        default: return FLAGS_REGISTER;
+    }
+}
+
+static void store_flags(void) {
+    gb->hardware.registers[F] = evaluate_flags();
+    gb->hardware.lazy_flags.operation = FLAGS_EVALUATED;
+}
+
+static void defer_flags(flag_operation_t operation, uint16_t val_1,
+                        uint16_t val_2, uint8_t carry) {
+    gb->hardware.lazy_flags.operation = operation;
+    gb->hardware.lazy_flags.val_1 = val_1;
+    gb->hardware.lazy_flags.val_2 = val_2;
+    gb->hardware.lazy_flags.carry = carry;
+}
+
 uint8_t get_flag(flags_t flag) {
-    const uint8_t FLAGS_REGISTER = hardware.registers[F];
-    return (FLAGS_REGISTER >> (7 - flag)) & 0x1;
+    return (evaluate_flags() >> (7 - flag)) & 0x1;
 }
 
 void set_flag(flags_t flag) {
-    uint8_t *FLAGS_REGISTER = &hardware.registers[F];
-    *FLAGS_REGISTER |= (1 << (7 - flag));
+    store_flags();
+    gb->hardware.registers[F] |= (1 << (7 - flag));
 }
 
 void reset_flag(flags_t flag) {
-    uint8_t *FLAGS_REGISTER = &hardware.registers[F];
-    *FLAGS_REGISTER &= ~(1 << (7 - flag));
+    store_flags();
+    gb->hardware.registers[F] &= ~(1 << (7 - flag));
+}
+
+void set_flags(bool z, bool n, bool h, bool c) {
+    gb->hardware.registers[F] = (gb->hardware.registers[F] & 0x0F) |
+                            flag_bit(Z_FLAG, z) | flag_bit(N_FLAG, n) |
+                            flag_bit(H_FLAG, h) | flag_bit(C_FLAG, c);
+    gb->hardware.lazy_flags.operation = FLAGS_EVALUATED;
+}
+
+// ADD and SUB produce all four flags so whatever was pending is dropped
+void set_flags_add(uint8_t val_1, uint8_t val_2, uint8_t carry) {
+    defer_flags(FLAGS_ADD, val_1, val_2, carry);
+}
+
+void set_flags_sub(uint8_t val_1, uint8_t val_2, uint8_t carry) {
+    defer_flags(FLAGS_SUB, val_1, val_2, carry);
+}
+
+// The rest keep some flags from before, which have to be stored first
+void set_flags_add16(uint16_t val_1, uint16_t val_2) {
+    store_flags();
+    defer_flags(FLAGS_ADD16, val_1, val_2, 0);
+}
+
+void set_flags_inc(uint8_t val) {
+    store_flags();
+    defer_flags(FLAGS_INC, val, 0, 0);
+}
+
+void set_flags_dec(uint8_t val) {
+    store_flags();
+    defer_flags(FLAGS_DEC, val, 0, 0);
 }
 
-void set_pc(uint16_t new_pc) { hardware.pc = new_pc; }
+void set_pc(uint16_t new_pc) { gb->hardware.pc = new_pc; }
 
-uint16_t get_pc(void) { return hardware.pc; }
+uint16_t get_pc(void) { return gb->hardware.pc; }
 
-void set_sp(uint16_t new_sp) { hardware.sp = new_sp; }
-void set_base_sp(uint16_t new_base) { hardware.base_sp = new_base; }
-uint16_t get_base_sp(void) { return hardware.base_sp; }
+void set_sp(uint16_t new_sp) { gb->hardware.sp = new_sp; }
+void set_base_sp(uint16_t new_base) { gb->hardware.base_sp = new_base; }
+uint16_t get_base_sp(void) { return gb->hardware.base_sp; }
 
 void stack_push_u16(uint16_t val) {
     uint8_t low = val & 0xFF;
@@ -101,32 +215,99 @@ uint8_t stack_pop_u8(void) {
     return val;
 }
 
-uint16_t get_sp(void) { return hardware.sp; }
+uint16_t get_sp(void) { return gb->hardware.sp; }
 
-void set_display_pixel(uint8_t x, uint8_t y, uint32_t pixel_color) {
-    hardware.display_buffer[y * DISPLAY_WIDTH + x] = pixel_color;
+void set_display_pixel(uint8_t x, uint8_t y, uint8_t shade) {
+    get_display_buffer()[y * DISPLAY_WIDTH + x] = shade;
 }
 
-uint32_t *get_display_buffer(void) { return hardware.display_buffer; }
+// The frame the PPU is drawing into
+uint8_t *get_display_buffer(void) {
+    DisplayBuffers *display_buffers = gb->hardware.display_buffers;
+    return display_buffers->frames[display_buffers->back];
+}
 
-void set_register(reg_t dst, uint8_t val) { hardware.registers[dst] = val; }
+static uint64_t hash_line(const uint8_t *shades) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint8_t x = 0; x < DISPLAY_WIDTH; x += sizeof(uint64_t)) {
+        uint64_t pixels;
+        memcpy(&pixels, &shades[x], sizeof(pixels));
+        hash = (hash ^ pixels) * 0x100000001B3;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
 
-uint8_t get_register(reg_t src) { return hardware.registers[src]; }
+/*
+ * Hands the finished frame over and carries on drawing into the oldest one.
+ * The line hashes are taken here rather than as lines are drawn so they always
+ * match the frame, even when the LCD was switched off halfway through a line.
+ */
+void publish_display_buffer(void) {
+    DisplayBuffers *display_buffers = gb->hardware.display_buffers;
+    const uint8_t *frame = display_buffers->frames[display_buffers->back];
+    uint64_t *line_hashes = display_buffers->line_hashes[display_buffers->back];
+    for (uint8_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        line_hashes[y] = hash_line(&frame[y * DISPLAY_WIDTH]);
+    }
+    const uint8_t PUBLISHED = (uint8_t)(display_buffers->back | NEW_FRAME_BIT);
+    display_buffers->back =
+        atomic_exchange(&display_buffers->shared, PUBLISHED) & FRAME_INDEX_MASK;
+}
+
+/*
+ * The newest complete frame, which stays untouched until the next call. Only
+ * one thread may present frames.
+ */
+const uint8_t *get_latest_frame(void) {
+    DisplayBuffers *display_buffers = gb->hardware.display_buffers;
+    if (atomic_load(&display_buffers->shared) & NEW_FRAME_BIT) {
+        display_buffers->front =
+            atomic_exchange(&display_buffers->shared, display_buffers->front) &
+            FRAME_INDEX_MASK;
+    }
+    return display_buffers->frames[display_buffers->front];
+}
+
+// Whether a frame was published since the last get_latest_frame call
+bool is_new_frame_ready(void) {
+    return atomic_load(&gb->hardware.display_buffers->shared) & NEW_FRAME_BIT;
+}
+
+// Line hashes of the frame the last get_latest_frame call returned
+const uint64_t *get_latest_line_hashes(void) {
+    DisplayBuffers *display_buffers = gb->hardware.display_buffers;
+    return display_buffers->line_hashes[display_buffers->front];
+}
+
+void set_register(reg_t dst, uint8_t val) {
+    if (dst == F) {
+        gb->hardware.lazy_flags.operation = FLAGS_EVALUATED;
+    }
+    gb->hardware.registers[dst] = val;
+}
+
+uint8_t get_register(reg_t src) {
+    if (src == F) {
+        return evaluate_flags();
+    }
+    return gb->hardware.registers[src];
+}
 
 void set_decoded_instruction(const char *str, ...) {
 #ifdef ENABLE_DEBUGGER
-    strncpy(hardware.previous_instruction, hardware.decoded_instruction,
+    strncpy(gb->hardware.previous_instruction, gb->hardware.decoded_instruction,
             MAX_DECODED_INSTRUCTION_SIZE);
     va_list args;
     va_start(args, str);
-    vsnprintf(hardware.decoded_instruction, MAX_DECODED_INSTRUCTION_SIZE, str,
-              args);
+    vsnprintf(gb->hardware.decoded_instruction, MAX_DECODED_INSTRUCTION_SIZE,
+              str, args);
 #endif
 }
 
-char *get_decoded_instruction(void) { return hardware.decoded_instruction; }
+char *get_decoded_instruction(void) { return gb->hardware.decoded_instruction; }
 char *get_previous_decoded_instruction(void) {
-    return hardware.previous_instruction;
+    return gb->hardware.previous_instruction;
 }
 
 void set_long_reg_u16(long_reg_t long_reg, uint16_t val) {
@@ -136,81 +317,88 @@ void set_long_reg_u16(long_reg_t long_reg, uint16_t val) {
 }
 
 void set_long_reg(long_reg_t long_reg, uint8_t b1, uint8_t b2) {
+    uint8_t *registers = gb->hardware.registers;
     switch (long_reg) {
         case BC:
-            hardware.registers[B] = b2;
-            hardware.registers[C] = b1;
+            registers[B] = b2;
+            registers[C] = b1;
             break;
         case DE:
-            hardware.registers[D] = b2;
-            hardware.registers[E] = b1;
+            registers[D] = b2;
+            registers[E] = b1;
             break;
         case HL:
-            hardware.registers[H] = b2;
-            hardware.registers[L] = b1;
+            registers[H] = b2;
+            registers[L] = b1;
             break;
         case AF:
-            hardware.registers[A] = b2;
-            hardware.registers[F] = b1;
+            registers[A] = b2;
+            registers[F] = b1;
+            gb->hardware.lazy_flags.operation = FLAGS_EVALUATED;
             break;
         default: exit(1); return;
     }
 }
 
 uint16_t get_long_reg(long_reg_t long_reg) {
+    const uint8_t *registers = gb->hardware.registers;
     switch (long_reg) {
-        case BC:
-            return two_u8s_to_u16(hardware.registers[C], hardware.registers[B]);
-        case DE:
-            return two_u8s_to_u16(hardware.registers[E], hardware.registers[D]);
-        case HL:
-            return two_u8s_to_u16(hardware.registers[L], hardware.registers[H]);
-        case AF:
-            return two_u8s_to_u16(hardware.registers[F], hardware.registers[A]);
+        case BC: return two_u8s_to_u16(registers[C], registers[B]);
+        case DE: return two_u8s_to_u16(registers[E], registers[D]);
+        case HL: return two_u8s_to_u16(registers[L], registers[H]);
+        case AF: return two_u8s_to_u16(evaluate_flags(), registers[A]);
         default: exit(1); return 0;
     }
 }
 
 void set_interrupt_state(enum INTERRUPT_STATE state) {
-    hardware.interrupt_state = state;
+    gb->hardware.interrupt_state = state;
+    update_pending_interrupts();
 }
 
 enum INTERRUPT_STATE get_interrupt_state(void) {
-    return hardware.interrupt_state;
+    return gb->hardware.interrupt_state;
 }
 
 void clear_instruction(void) {
-    hardware.instruction[0] = 0;
-    hardware.instruction[1] = 0;
-    hardware.instruction[2] = 0;
+    gb->hardware.instruction[0] = 0;
+    gb->hardware.instruction[1] = 0;
+    gb->hardware.instruction[2] = 0;
 }
 
 void append_instruction(uint8_t pos) {
-    hardware.instruction[pos] = get_memory_byte(post_inc(&hardware.pc));
+    gb->hardware.instruction[pos] = get_memory_byte(post_inc(&gb->hardware.pc));
     return;
 }
 
-uint8_t *get_instruction(void) { return hardware.instruction; }
+uint8_t *get_instruction(void) { return gb->hardware.instruction; }
 
-void inc_instruction_count(void) { hardware.instruction_count++; }
+void inc_instruction_count(void) { gb->hardware.instruction_count++; }
 
-uint64_t get_instruction_count(void) { return hardware.instruction_count; }
+void add_instruction_count(uint64_t count) {
+    gb->hardware.instruction_count += count;
+}
+
+uint64_t get_instruction_count(void) { return gb->hardware.instruction_count; }
 
-void set_is_implemented(bool val) { hardware.is_implemented = val; }
+void set_is_implemented(bool val) { gb->hardware.is_implemented = val; }
 
-bool get_is_implemented(void) { return hardware.is_implemented; }
+bool get_is_implemented(void) { return gb->hardware.is_implemented; }
 
-uint8_t get_mode(void) { return hardware.mode; }
+uint8_t get_mode(void) { return gb->hardware.mode; }
 
-uint8_t get_ime_flag(void) { return hardware.ime_flag; }
-void set_ime_flag(bool val) { hardware.ime_flag = val; }
+uint8_t get_ime_flag(void) { return gb->hardware.ime_flag; }
+void set_ime_flag(bool val) {
+    gb->hardware.ime_flag = val;
+    update_pending_interrupts();
+}
 
-bool get_oam_dma_transfer(void) { return hardware.oam_dma_started; }
+bool get_oam_dma_transfer(void) { return gb->hardware.oam_dma_started; }
 
 void set_oam_dma_transfer(bool oam_dma_transfer_is_enabled) {
-    hardware.oam_dma_started = oam_dma_transfer_is_enabled;
+    gb->hardware.oam_dma_started = oam_dma_transfer_is_enabled;
 }
 
-void set_halted(bool halt_state) { hardware.is_halted = halt_state; }
+void set_halted(bool halt_state) { gb->hardware.is_halted = halt_state; }
 
-bool is_halted(void) { return hardware.is_halted; }
+bool is_halted(void) { return gb->hardware.is_halted; }
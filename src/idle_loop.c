@@ -0,0 +1,301 @@
+#include "idle_loop.h"
+#include "context.h"
+#include "cpu.h"
+#include "hardware.h"
+#include "interrupts.h"
+#include "memory.h"
+#include "ppu.h"
+#include "scheduler.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Games often busy-wait on LY, STAT or a flag set by an interrupt handler. A
+ * loop made only of reads, register operations and a branch back to its start
+ * can't change anything but registers, so once one pass finishes with the
+ * registers exactly as they were at the start of it, every following pass
+ * does the same thing until an event, the PPU or the timer changes what the
+ * loop reads. The CPU can then skip over whole passes up to the next of those,
+ * only counting the PPU and the timer if the loop reads anything they change.
+ */
+
+
+// Instructions that only read memory and change registers and flags
+static bool is_idle_safe(const cached_instruction_t *cached) {
+    const uint8_t OPCODE = cached->instruction[0];
+    if (OPCODE == 0xCB) {
+        const uint8_t PREFIXED_OPCODE = cached->instruction[1];
+        // BIT reads (HL), everything else writes it back
+        return (PREFIXED_OPCODE >= 0x40 && PREFIXED_OPCODE < 0x80) ||
+               (PREFIXED_OPCODE & 0x07) != 0x06;
+    }
+    if (OPCODE >= 0x40 && OPCODE < 0x80) {
+        // LD r, r' and LD r, (HL) but not LD (HL), r or HALT
+        return OPCODE < 0x70 || OPCODE >= 0x78;
+    }
+    if (OPCODE >= 0x80 && OPCODE < 0xC0) {
+        return true;
+    }
+    switch (OPCODE) {
+        /* clang-format off */
+        case 0x00: case 0x07: case 0x0F: case 0x17: case 0x1F: // NOP, rotates
+        case 0x27: case 0x2F: case 0x37: case 0x3F:           // DAA CPL SCF CCF
+        case 0x0A: case 0x1A: case 0xF0: case 0xF2: case 0xFA: // loads into A
+        case 0x06: case 0x0E: case 0x16: case 0x1E:           // LD r, n
+        case 0x26: case 0x2E: case 0x3E:
+        case 0x04: case 0x05: case 0x0C: case 0x0D:           // INC/DEC r
+        case 0x14: case 0x15: case 0x1C: case 0x1D:
+        case 0x24: case 0x25: case 0x2C: case 0x2D: case 0x3C: case 0x3D:
+        case 0x03: case 0x0B: case 0x13: case 0x1B:           // INC/DEC rr
+        case 0x23: case 0x2B: case 0x33: case 0x3B:
+        case 0x09: case 0x19: case 0x29: case 0x39:           // ADD HL, rr
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE:           // ALU A, n
+        case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            /* clang-format on */
+            return true;
+        default: return false;
+    }
+}
+
+// Target of a JR or JP, or -1 for anything else
+static int32_t get_branch_target(const cached_instruction_t *cached) {
+    const uint8_t *instruction = cached->instruction;
+    switch (instruction[0]) {
+        case 0x18:
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+            return (uint16_t)(cached->pc + cached->length +
+                              (int8_t)instruction[1]);
+        case 0xC2:
+        case 0xC3:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA: return (uint16_t)(instruction[1] | (instruction[2] << 8));
+        default: return -1;
+    }
+}
+
+bool is_idle_loop_candidate(const cached_instruction_t *instructions,
+                            uint8_t count) {
+    if (count == 0 ||
+        get_branch_target(&instructions[count - 1]) != instructions[0].pc) {
+        return false;
+    }
+    for (uint8_t i = 0; i + 1 < count; i++) {
+        if (!is_idle_safe(&instructions[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether an instruction may change a register memory is read through
+static bool writes_pointer_register(const cached_instruction_t *cached) {
+    const uint8_t OPCODE = cached->instruction[0];
+    if (OPCODE == 0xCB) {
+        const uint8_t PREFIXED_OPCODE = cached->instruction[1];
+        return (PREFIXED_OPCODE < 0x40 || PREFIXED_OPCODE >= 0x80) &&
+               (PREFIXED_OPCODE & 0x07) != 0x07;
+    }
+    if (OPCODE >= 0x40 && OPCODE < 0x80) {
+        return (OPCODE & 0x38) != 0x38;
+    }
+    if (OPCODE >= 0x40) {
+        return false;
+    }
+    switch (OPCODE & 0x07) {
+        case 0x03: return true;
+        case 0x04:
+        case 0x05:
+        case 0x06: return (OPCODE & 0x38) != 0x38;
+        default: return (OPCODE & 0x0F) == 0x09;
+    }
+}
+
+static uint8_t get_read_pointer(const cached_instruction_t *cached) {
+    const uint8_t OPCODE = cached->instruction[0];
+    if (OPCODE == 0xCB) {
+        return (cached->instruction[1] & 0x07) == 0x06 ? READS_THROUGH_HL : 0;
+    }
+    if (OPCODE >= 0x40 && OPCODE < 0xC0) {
+        return (OPCODE & 0x07) == 0x06 ? READS_THROUGH_HL : 0;
+    }
+    switch (OPCODE) {
+        case 0x0A: return READS_THROUGH_BC;
+        case 0x1A: return READS_THROUGH_DE;
+        case 0xF2: return READS_THROUGH_C;
+        default: return 0;
+    }
+}
+
+static uint8_t get_address_sources(uint16_t address) {
+    if (address == LCDY) {
+        return POLLS_LY;
+    }
+    if (address == DIV || address == TIMA) {
+        return POLLS_TIMER;
+    }
+    if (address == STAT || (address >= VRAM_BASE && address < EX_RAM_BASE) ||
+        (address >= OAM_BASE && address < IO_RAM_BASE)) {
+        return POLLS_PPU_MODE;
+    }
+    return 0;
+}
+
+/*
+ * Direct reads are looked up once. Reads through a register pair wait for
+ * the registers of the first pass unless the loop changes the pairs, in
+ * which case they could read anything.
+ */
+void find_polled_sources(basic_block_t *block) {
+    block->polled_sources = 0;
+    block->polled_pointers = 0;
+    if (!block->may_idle) {
+        return;
+    }
+    bool keeps_pointers = true;
+    for (uint8_t i = 0; i + 1 < block->instruction_count; i++) {
+        const cached_instruction_t *cached = &block->instructions[i];
+        const uint8_t *instruction = cached->instruction;
+        keeps_pointers = keeps_pointers && !writes_pointer_register(cached);
+        block->polled_pointers |= get_read_pointer(cached);
+        if (instruction[0] == 0xF0) {
+            block->polled_sources |=
+                get_address_sources((uint16_t)(IO_RAM_BASE + instruction[1]));
+        } else if (instruction[0] == 0xFA) {
+            block->polled_sources |= get_address_sources(
+                (uint16_t)(instruction[1] | (instruction[2] << 8)));
+        }
+    }
+    if (!keeps_pointers && block->polled_pointers) {
+        block->polled_sources = POLLS_ANYTHING;
+        block->polled_pointers = 0;
+    }
+}
+
+static uint8_t get_polled_sources(const basic_block_t *block) {
+    const uint8_t POINTERS = block->polled_pointers;
+    uint8_t sources = block->polled_sources;
+    if (POINTERS & READS_THROUGH_BC) {
+        sources |= get_address_sources(get_long_reg(BC));
+    }
+    if (POINTERS & READS_THROUGH_DE) {
+        sources |= get_address_sources(get_long_reg(DE));
+    }
+    if (POINTERS & READS_THROUGH_HL) {
+        sources |= get_address_sources(get_long_reg(HL));
+    }
+    if (POINTERS & READS_THROUGH_C) {
+        sources |=
+            get_address_sources((uint16_t)(IO_RAM_BASE + get_register(C)));
+    }
+    return sources;
+}
+
+/*
+ * The PPU and the timer only catch up when they're looked at, so they have no
+ * events for the LY, mode, DIV or TIMA changes the loop may be waiting for.
+ * A mode change is never later than the next line.
+ */
+static uint64_t get_next_polled_change(const basic_block_t *block) {
+    const uint8_t SOURCES = get_polled_sources(block);
+    uint64_t next_change = UINT64_MAX;
+    if (SOURCES & POLLS_PPU_MODE) {
+        next_change = get_next_ppu_change_cycle();
+    } else if (SOURCES & POLLS_LY) {
+        next_change = get_next_line_cycle();
+    }
+    if (SOURCES & POLLS_TIMER) {
+        const uint64_t NEXT_TICK = get_next_timer_change_cycle();
+        if (NEXT_TICK < next_change) {
+            next_change = NEXT_TICK;
+        }
+    }
+    return next_change;
+}
+
+static void record_visit(loop_visit_t *visit, const basic_block_t *block) {
+    visit->block = block;
+    visit->cycle = get_cycles();
+    visit->instruction_count = get_instruction_count();
+    visit->handled_events = get_handled_event_count();
+    visit->next_change = get_next_polled_change(block);
+    for (uint8_t reg = 0; reg < NUM_OF_LOOP_REGISTERS; reg++) {
+        visit->registers[reg] = get_register((reg_t)reg);
+    }
+    visit->sp = get_sp();
+}
+
+static bool is_inside_loop(const basic_block_t *block) {
+    const basic_block_t *loop = gb->idle_loop.previous_visit.block;
+    return loop && block->bank == loop->bank &&
+           block->start_pc > loop->start_pc &&
+           block->start_pc <=
+               loop->instructions[loop->instruction_count - 1].pc;
+}
+
+/*
+ * Called when execution reaches the start of a block. Returns the clocks of
+ * the passes that were skipped, which the caller retires along with the next
+ * instruction.
+ */
+clock_cycles_t skip_idle_loop(const basic_block_t *block) {
+    loop_visit_t *previous_visit = &gb->idle_loop.previous_visit;
+    if (block && !block->may_idle && is_inside_loop(block)) {
+        // A compiled block that returned early resumes here
+        return 0;
+    }
+    if (!block || !block->may_idle || get_oam_dma_transfer()) {
+        previous_visit->block = NULL;
+        return 0;
+    }
+    loop_visit_t visit;
+    record_visit(&visit, block);
+    // Exactly one pass with nothing but the loop itself running in between
+    bool is_idle =
+        previous_visit->block == block &&
+        visit.instruction_count - previous_visit->instruction_count ==
+            block->instruction_count &&
+        visit.handled_events == previous_visit->handled_events &&
+        visit.cycle < previous_visit->next_change &&
+        visit.sp == previous_visit->sp &&
+        memcmp(visit.registers, previous_visit->registers,
+               NUM_OF_LOOP_REGISTERS) == 0;
+    const uint64_t PASS_CYCLES = visit.cycle - previous_visit->cycle;
+    *previous_visit = visit;
+    uint64_t next_change = get_next_event_cycle();
+    if (visit.next_change < next_change) {
+        next_change = visit.next_change;
+    }
+    if (!is_idle || get_step_mode() || get_interrupt_state() != NOTHING ||
+        next_change == UINT64_MAX) {
+        return 0;
+    }
+
+    // Stop short of the pass the next event or change happens in
+    const uint64_t PASSES = (next_change - visit.cycle - 1) / PASS_CYCLES;
+    if (PASSES == 0) {
+        return 0;
+    }
+    const uint64_t SKIPPED_CYCLES = PASSES * PASS_CYCLES;
+    add_instruction_count(PASSES * block->instruction_count);
+    previous_visit->cycle += SKIPPED_CYCLES;
+    previous_visit->instruction_count += PASSES * block->instruction_count;
+    gb->idle_loop.stats.skips++;
+    gb->idle_loop.stats.skipped_iterations += PASSES;
+    gb->idle_loop.stats.skipped_cycles += SKIPPED_CYCLES;
+    return (clock_cycles_t)SKIPPED_CYCLES;
+}
+
+idle_loop_stats_t get_idle_loop_stats(void) { return gb->idle_loop.stats; }
+
+void print_idle_loop_stats(void) {
+    fprintf(stderr,
+            "Idle loops: %" PRIu64 " skips, %" PRIu64 " iterations, %" PRIu64
+            " cycles skipped\n",
+            gb->idle_loop.stats.skips, gb->idle_loop.stats.skipped_iterations,
+            gb->idle_loop.stats.skipped_cycles);
+}
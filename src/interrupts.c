@@ -1,4 +1,5 @@
 #include "interrupts.h"
+#include "context.h"
 #include "cpu.h"
 #include "hardware.h"
 #include "memory.h"
@@ -10,13 +11,40 @@ interrupts_t get_highest_priority_interrupt(void);
 void reset_interrupt_flag(interrupts_t interrupt);
 uint16_t get_interrupt_handler(interrupts_t interrupt);
 
-void set_interrupts_flag(interrupts_t interrupt) {
-    set_memory_byte(IF, get_memory_byte(IF) | (uint8_t)(1 << interrupt));
+#define INTERRUPT_MASK ((1 << NUM_OF_INTERRUPTS) - 1)
+
+/*
+ * pending is what wakes the CPU from HALT, needs_handling is set whenever
+ * handle_interrupts has anything to do, so the usual case is a single check.
+ */
+void update_pending_interrupts(void) {
+    InterruptState *interrupts = &gb->interrupts;
+    interrupts->pending =
+        interrupts->enabled & interrupts->requested & INTERRUPT_MASK;
+    interrupts->needs_handling = (get_ime_flag() && interrupts->pending) ||
+                                 get_interrupt_state() != NOTHING;
+}
+
+void set_interrupt_flags(uint8_t flags) {
+    gb->interrupts.requested = flags;
+    gb->memory.io_ram[IF - IO_RAM_BASE] = flags;
+    update_pending_interrupts();
 }
 
-static uint32_t serviced_interrupts[NUM_OF_INTERRUPTS] = {0, 0, 0, 0, 0};
+void set_interrupt_enable(uint8_t enable) {
+    gb->interrupts.enabled = enable;
+    gb->memory.io_ram[IE - IO_RAM_BASE] = enable;
+    update_pending_interrupts();
+}
+
+void set_interrupts_flag(interrupts_t interrupt) {
+    set_interrupt_flags(gb->interrupts.requested | (uint8_t)(1 << interrupt));
+}
 
 clock_cycles_t handle_interrupts(void) {
+    if (!gb->interrupts.needs_handling) {
+        return 0;
+    }
     enum INTERRUPT_STATE interrupt_state = get_interrupt_state();
     if (interrupt_state == ENABLE) {
         // Allows one instruction to go through when calling EI
@@ -29,7 +57,7 @@ clock_cycles_t handle_interrupts(void) {
         set_interrupt_state(NOTHING);
     }
 
-    if (!get_ime_flag() || !(get_memory_byte(IE) & get_memory_byte(IF))) {
+    if (!get_ime_flag() || !gb->interrupts.pending) {
         return 0;
     }
     set_halted(false);
@@ -44,7 +72,7 @@ clock_cycles_t handle_interrupts(void) {
 }
 
 interrupts_t get_highest_priority_interrupt(void) {
-    uint8_t available_interrupts = get_memory_byte(IE) & get_memory_byte(IF);
+    const uint8_t available_interrupts = gb->interrupts.pending;
     for (uint8_t i = 0; i < NUM_OF_INTERRUPTS; i++) {
         if (available_interrupts & (1 << i)) {
             return i;
@@ -54,12 +82,11 @@ interrupts_t get_highest_priority_interrupt(void) {
 }
 
 void reset_interrupt_flag(interrupts_t interrupt) {
-    uint8_t current_interrupt_flags = get_memory_byte(IF);
-    set_memory_byte(IF, current_interrupt_flags & ~(1 << interrupt));
+    set_interrupt_flags(gb->interrupts.requested & (uint8_t)~(1 << interrupt));
 }
 
 uint16_t get_interrupt_handler(interrupts_t interrupt) {
-    serviced_interrupts[interrupt] += 1;
+    gb->interrupts.serviced_interrupts[interrupt] += 1;
     switch (interrupt) {
         case VBLANK: return 0x40;
         case LCD: return 0x48;
@@ -70,4 +97,6 @@ uint16_t get_interrupt_handler(interrupts_t interrupt) {
     }
 }
 
-uint32_t *get_serviced_interrupts(void) { return serviced_interrupts; }
+uint32_t *get_serviced_interrupts(void) {
+    return gb->interrupts.serviced_interrupts;
+}
@@ -1,52 +1,140 @@
 #include "hardware.h"
+#include "context.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "scheduler.h"
 #include "utils.h"
 
-static void update_DIV_register(clock_cycles_t clocks);
-static void update_TIMA_register(clock_cycles_t clocks);
+#define DIV_PERIOD 256
+#define TIMA_OVERFLOW 0x100
 
-void update_timer(clock_cycles_t clocks) {
-    update_DIV_register(clocks);
-    update_TIMA_register(clocks);
+/*
+ * DIV is the upper byte of a 16 bit counter that counts every clock and TIMA
+ * counts the falling edges of one of its bits, selected by TAC. Neither is
+ * stepped: DIV is worked out from the cycle the counter was last reset on
+ * whenever it's read and TIMA is only brought up to date when it's read or
+ * written, when TAC, TMA or DIV are written and when it overflows, which is
+ * the only thing scheduled.
+ */
+
+static uint64_t get_counter(uint64_t cycle) {
+    return cycle - gb->timer.counter_reset_at;
 }
 
-void update_TIMA_register(clock_cycles_t clocks) {
-    static uint16_t TIMA_progress = 0;
-    uint8_t TAC_register = get_memory_byte(TAC);
-    uint8_t TAC_enabled = get_bit(TAC_register, 2);
+// Clocks between falling edges of the counter bit TIMA counts, 0 if stopped
+static uint32_t get_TIMA_period(uint8_t TAC_register) {
+    if (!get_bit(TAC_register, 2)) {
+        return 0;
+    }
+    switch (TAC_register & 0x03) {
+        case 0x00: return 1024;
+        case 0x01: return 16;
+        case 0x02: return 64;
+        case 0x03: return 256;
+        default: return 0;
+    }
+}
 
-    if (!TAC_enabled) {
-        return;
+// Whether the counter bit TIMA counts is set, with the enable bit ANDed in
+static bool get_TIMA_input(uint8_t TAC_register, uint64_t counter) {
+    const uint32_t PERIOD = get_TIMA_period(TAC_register);
+    return PERIOD && (counter & (PERIOD / 2));
+}
+
+static void increase_TIMA(uint64_t increments) {
+    uint8_t *io_ram = gb->memory.io_ram;
+    while (increments > 0) {
+        const uint32_t ROOM = TIMA_OVERFLOW - io_ram[TIMA - IO_RAM_BASE];
+        if (increments < ROOM) {
+            io_ram[TIMA - IO_RAM_BASE] =
+                (uint8_t)(io_ram[TIMA - IO_RAM_BASE] + increments);
+            return;
+        }
+        increments -= ROOM;
+        io_ram[TIMA - IO_RAM_BASE] = io_ram[TMA - IO_RAM_BASE];
+        set_interrupts_flag(TIMER);
     }
+}
 
-    TIMA_progress += clocks;
+// Counts the falling edges since TIMA was last brought up to date
+static void sync_TIMA(void) {
+    const uint64_t NOW = get_cycles();
+    const uint8_t TAC_REGISTER = gb->memory.io_ram[TAC - IO_RAM_BASE];
+    const uint32_t PERIOD = get_TIMA_period(TAC_REGISTER);
+    if (PERIOD) {
+        increase_TIMA(get_counter(NOW) / PERIOD -
+                      get_counter(gb->timer.synced_at) / PERIOD);
+    }
+    gb->timer.synced_at = NOW;
+}
 
-    uint16_t TIMA_clock_rate = 256;
-    uint8_t clock_select = TAC_register & 0x03;
+static void schedule_timer(void) {
+    const uint8_t *io_ram = gb->memory.io_ram;
+    const uint32_t PERIOD = get_TIMA_period(io_ram[TAC - IO_RAM_BASE]);
+    if (!PERIOD) {
+        cancel_event(TIMER_EVENT);
+        return;
+    }
+    const uint64_t EDGES = get_counter(gb->timer.synced_at) / PERIOD +
+                           TIMA_OVERFLOW - io_ram[TIMA - IO_RAM_BASE];
+    schedule_event(TIMER_EVENT, gb->timer.counter_reset_at + EDGES * PERIOD);
+}
 
-    switch (clock_select) {
-        case 0x00: TIMA_clock_rate = 256; break;
-        case 0x01: TIMA_clock_rate = 4; break;
-        case 0x02: TIMA_clock_rate = 16; break;
-        case 0x03: TIMA_clock_rate = 64; break;
+void handle_timer_event(void) {
+    sync_TIMA();
+    schedule_timer();
+}
+
+uint8_t read_timer_register(uint16_t address) {
+    uint8_t *io_ram = gb->memory.io_ram;
+    switch (address) {
+        case DIV:
+            io_ram[DIV - IO_RAM_BASE] =
+                (uint8_t)(get_counter(get_cycles()) / DIV_PERIOD);
+            break;
+        case TIMA: sync_TIMA(); break;
         default: break;
     }
+    return io_ram[address - IO_RAM_BASE];
+}
 
-    while (TIMA_progress > TIMA_clock_rate) {
-        TIMA_progress -= TIMA_clock_rate;
-        TIMA_progress = TIMA_progress % TIMA_clock_rate;
-        uint16_t TIMA_value = privileged_get_memory_byte(TIMA) + 1;
-        if (TIMA_value >= UINT8_MAX) {
-            uint8_t TMA_val = privileged_get_memory_byte(TMA);
-            TIMA_value = TMA_val;
-            set_interrupts_flag(TIMER);
+/*
+ * TIMA only sees its input bit fall, so resetting the counter or changing
+ * TAC while the selected bit is set counts as an edge too.
+ */
+void write_timer_register(uint16_t address, uint8_t byte) {
+    uint8_t *io_ram = gb->memory.io_ram;
+    const uint64_t NOW = get_cycles();
+    sync_TIMA();
+    switch (address) {
+        case DIV:
+            if (get_TIMA_input(io_ram[TAC - IO_RAM_BASE], get_counter(NOW))) {
+                increase_TIMA(1);
+            }
+            gb->timer.counter_reset_at = NOW;
+            io_ram[DIV - IO_RAM_BASE] = 0;
+            break;
+        case TAC: {
+            const bool WAS_SET =
+                get_TIMA_input(io_ram[TAC - IO_RAM_BASE], get_counter(NOW));
+            io_ram[TAC - IO_RAM_BASE] = byte;
+            if (WAS_SET && !get_TIMA_input(byte, get_counter(NOW))) {
+                increase_TIMA(1);
+            }
+            break;
         }
-        privileged_set_memory_byte(TIMA, (uint8_t)TIMA_value);
+        default: io_ram[address - IO_RAM_BASE] = byte; break;
     }
+    schedule_timer();
 }
-void update_DIV_register(clock_cycles_t clocks) {
-    static uint16_t DIV_progress = 0;
-    DIV_progress += clocks;
-    privileged_set_memory_byte(DIV, DIV_progress >> 8);
+
+// First cycle DIV or TIMA reads differently at
+uint64_t get_next_timer_change_cycle(void) {
+    const uint64_t COUNTER = get_counter(get_cycles());
+    const uint8_t TAC_REGISTER = gb->memory.io_ram[TAC - IO_RAM_BASE];
+    uint32_t period = get_TIMA_period(TAC_REGISTER);
+    if (!period || period > DIV_PERIOD) {
+        period = DIV_PERIOD;
+    }
+    return get_cycles() + period - COUNTER % period;
 }
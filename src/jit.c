@@ -0,0 +1,952 @@
+// MAP_ANONYMOUS is hidden by glibc under -std=c1x
+#define _DEFAULT_SOURCE
+#include "jit.h"
+#include "block_cache.h"
+#include "context.h"
+#include "decoder.h"
+#include "hardware.h"
+#include "idle_loop.h"
+#include "memory.h"
+#include "scheduler.h"
+#include "utils.h"
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__APPLE__) || defined(__unix__))
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+/*
+ * Hot ROM blocks from the block cache are translated into x86-64. Register
+ * loads, 8 bit ALU operations, INC/DEC, loads and stores and jumps are
+ * emitted inline, with ADD, SUB and CP deferring their flags the same way
+ * the handlers do. Loads and stores go through the page tables and only call
+ * out for unmapped pages, everything else calls the instruction's handler.
+ *
+ * A block only runs natively when no event can come due before its last
+ * instruction, so the block adds up its own clocks and step_cpu retires them
+ * once when it returns. Call outs still see the cycle the interpreter would
+ * have been at. If a call out raises an interrupt, schedules an event or
+ * switches banks the block returns straight after that instruction.
+ */
+
+#define JIT_HOT_THRESHOLD 16
+#define JIT_ARENA_SIZE (4 * 1024 * 1024)
+// Upper bound on the code emitted for one instruction including its exit
+#define MAX_EMITTED_INSTRUCTION_SIZE 256
+// Handlers keep the debugger's decoded instruction up to date
+#ifdef ENABLE_DEBUGGER
+#define EMIT_INLINE false
+#else
+#define EMIT_INLINE true
+#endif
+
+#ifdef JIT_SUPPORTED
+
+/*
+ * Compiled blocks keep &gb->hardware in rbx, the cycle the block was entered
+ * on plus the clocks in front of it in r12, the clocks run by the block so
+ * far in r13 and the read and write page tables in r14 and r15.
+ */
+enum X86_REGISTER { EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI };
+
+typedef struct CodeBuffer {
+    uint8_t *code;
+    size_t used;
+    size_t size;
+    // Set when the instruction being emitted can call out to C
+    bool calls_out;
+} code_buffer_t;
+
+static void emit_u8(code_buffer_t *buffer, uint8_t byte) {
+    buffer->code[buffer->used++] = byte;
+}
+
+static void emit_u16(code_buffer_t *buffer, uint16_t val) {
+    memcpy(&buffer->code[buffer->used], &val, sizeof(val));
+    buffer->used += sizeof(val);
+}
+
+static void emit_u32(code_buffer_t *buffer, uint32_t val) {
+    memcpy(&buffer->code[buffer->used], &val, sizeof(val));
+    buffer->used += sizeof(val);
+}
+
+static void emit_u64(code_buffer_t *buffer, uint64_t val) {
+    memcpy(&buffer->code[buffer->used], &val, sizeof(val));
+    buffer->used += sizeof(val);
+}
+
+// ModRM and displacement for [rbx + offset], where rbx is &gb->hardware
+static void emit_hardware_operand(code_buffer_t *buffer, uint8_t reg,
+                                  size_t offset) {
+    emit_u8(buffer, (uint8_t)(0x83 | reg << 3));
+    emit_u32(buffer, (uint32_t)offset);
+}
+
+// mov rax, imm64
+static void emit_load_rax(code_buffer_t *buffer, const void *pointer) {
+    emit_u8(buffer, 0x48);
+    emit_u8(buffer, 0xB8);
+    emit_u64(buffer, (uint64_t)(uintptr_t)pointer);
+}
+
+// mov rax, imm64 ; call rax
+static void emit_call(code_buffer_t *buffer, uintptr_t function) {
+    emit_u8(buffer, 0x48);
+    emit_u8(buffer, 0xB8);
+    emit_u64(buffer, (uint64_t)function);
+    emit_u8(buffer, 0xFF);
+    emit_u8(buffer, 0xD0);
+}
+
+// jmp rel32 or jcc rel32 to a label emitted later, see patch_jump
+static size_t emit_forward_jump(code_buffer_t *buffer, uint8_t condition) {
+    if (condition) {
+        emit_u8(buffer, 0x0F);
+        emit_u8(buffer, condition);
+    } else {
+        emit_u8(buffer, 0xE9);
+    }
+    emit_u32(buffer, 0);
+    return buffer->used;
+}
+
+static void patch_jump(code_buffer_t *buffer, size_t jump_end) {
+    const uint32_t DISTANCE = (uint32_t)(buffer->used - jump_end);
+    memcpy(&buffer->code[jump_end - sizeof(DISTANCE)], &DISTANCE,
+           sizeof(DISTANCE));
+}
+
+#define JZ 0x84
+#define JNZ 0x85
+
+static size_t register_offset(reg_t reg) {
+    return offsetof(Hardware, registers) + reg;
+}
+
+// movzx reg, byte [register]
+static void emit_load_register(code_buffer_t *buffer, uint8_t reg,
+                               reg_t src) {
+    emit_u8(buffer, 0x0F);
+    emit_u8(buffer, 0xB6);
+    emit_hardware_operand(buffer, reg, register_offset(src));
+}
+
+// mov byte [register], reg
+static void emit_store_register(code_buffer_t *buffer, uint8_t reg,
+                                reg_t dst) {
+    emit_u8(buffer, 0x88);
+    emit_hardware_operand(buffer, reg, register_offset(dst));
+}
+
+/*
+ * Register pairs are stored high byte first, so the word is loaded and its
+ * bytes swapped: movzx reg, word [pair] ; rol reg16, 8
+ */
+static void emit_load_pair(code_buffer_t *buffer, uint8_t reg,
+                           long_reg_t src) {
+    emit_u8(buffer, 0x0F);
+    emit_u8(buffer, 0xB7);
+    emit_hardware_operand(buffer, reg, register_offset((reg_t)(src * 2)));
+    emit_u8(buffer, 0x66);
+    emit_u8(buffer, 0xC1);
+    emit_u8(buffer, (uint8_t)(0xC0 | reg));
+    emit_u8(buffer, 0x08);
+}
+
+// rol reg16, 8 ; mov word [pair], reg16
+static void emit_store_pair(code_buffer_t *buffer, uint8_t reg,
+                            long_reg_t dst) {
+    emit_u8(buffer, 0x66);
+    emit_u8(buffer, 0xC1);
+    emit_u8(buffer, (uint8_t)(0xC0 | reg));
+    emit_u8(buffer, 0x08);
+    emit_u8(buffer, 0x66);
+    emit_u8(buffer, 0x89);
+    emit_hardware_operand(buffer, reg, register_offset((reg_t)(dst * 2)));
+}
+
+// Increments or decrements a register pair through eax
+static void emit_step_pair(code_buffer_t *buffer, long_reg_t pair,
+                           bool increment) {
+    emit_load_pair(buffer, EAX, pair);
+    emit_u8(buffer, 0xFF); // inc eax / dec eax
+    emit_u8(buffer, increment ? 0xC0 : 0xC8);
+    emit_store_pair(buffer, EAX, pair);
+}
+
+/*
+ * Same as defer_flags with val_1 and val_2 in registers and no carry. A
+ * negative val_2 stores 0 like INC and DEC do.
+ */
+static void emit_defer_flags(code_buffer_t *buffer, flag_operation_t operation,
+                             uint8_t val_1, int val_2) {
+    const size_t FLAGS = offsetof(Hardware, lazy_flags);
+    // mov dword [operation], imm32
+    emit_u8(buffer, 0xC7);
+    emit_hardware_operand(buffer, 0, FLAGS + offsetof(lazy_flags_t, operation));
+    emit_u32(buffer, (uint32_t)operation);
+    // mov word [val_1], reg16
+    emit_u8(buffer, 0x66);
+    emit_u8(buffer, 0x89);
+    emit_hardware_operand(buffer, val_1, FLAGS + offsetof(lazy_flags_t, val_1));
+    if (val_2 < 0) {
+        // mov word [val_2], 0
+        emit_u8(buffer, 0x66);
+        emit_u8(buffer, 0xC7);
+        emit_hardware_operand(buffer, 0,
+                              FLAGS + offsetof(lazy_flags_t, val_2));
+        emit_u16(buffer, 0);
+    } else {
+        emit_u8(buffer, 0x66);
+        emit_u8(buffer, 0x89);
+        emit_hardware_operand(buffer, (uint8_t)val_2,
+                              FLAGS + offsetof(lazy_flags_t, val_2));
+    }
+    // mov byte [carry], 0
+    emit_u8(buffer, 0xC6);
+    emit_hardware_operand(buffer, 0, FLAGS + offsetof(lazy_flags_t, carry));
+    emit_u8(buffer, 0);
+}
+
+// Same as set_flags(!al, 0, half_carry, 0)
+static void emit_set_flags(code_buffer_t *buffer, bool half_carry) {
+    emit_load_register(buffer, EDX, F);
+    emit_u8(buffer, 0x83); // and edx, 0x0F
+    emit_u8(buffer, 0xE2);
+    emit_u8(buffer, 0x0F);
+    emit_u8(buffer, 0x84); // test al, al
+    emit_u8(buffer, 0xC0);
+    emit_u8(buffer, 0x0F); // sete cl
+    emit_u8(buffer, 0x94);
+    emit_u8(buffer, 0xC1);
+    emit_u8(buffer, 0x0F); // movzx ecx, cl
+    emit_u8(buffer, 0xB6);
+    emit_u8(buffer, 0xC9);
+    emit_u8(buffer, 0xC1); // shl ecx, 7
+    emit_u8(buffer, 0xE1);
+    emit_u8(buffer, 0x07);
+    emit_u8(buffer, 0x09); // or edx, ecx
+    emit_u8(buffer, 0xCA);
+    if (half_carry) {
+        emit_u8(buffer, 0x83); // or edx, 0x20
+        emit_u8(buffer, 0xCA);
+        emit_u8(buffer, 0x20);
+    }
+    emit_store_register(buffer, EDX, F);
+    // mov dword [operation], FLAGS_EVALUATED
+    emit_u8(buffer, 0xC7);
+    emit_hardware_operand(buffer, 0,
+                          offsetof(Hardware, lazy_flags) +
+                              offsetof(lazy_flags_t, operation));
+    emit_u32(buffer, FLAGS_EVALUATED);
+}
+
+// The cycle an instruction sees, see execute_jit_block, into a 64 bit reg
+static void emit_visible_cycle(code_buffer_t *buffer, uint8_t reg,
+                               uint8_t index) {
+    if (index == 0) {
+        // The first instruction runs on the cycle the block was entered on
+        emit_load_rax(buffer, &gb->scheduler.cycles);
+        emit_u8(buffer, 0x48); // mov reg, [rax]
+        emit_u8(buffer, 0x8B);
+        emit_u8(buffer, (uint8_t)(reg << 3));
+    } else {
+        emit_u8(buffer, 0x4B); // lea reg, [r12 + r13]
+        emit_u8(buffer, 0x8D);
+        emit_u8(buffer, (uint8_t)(0x04 | reg << 3));
+        emit_u8(buffer, 0x2C);
+    }
+}
+
+// Whether something the rest of the block relies on changed under it
+static void check_block_exit(void) {
+    if (gb->interrupts.needs_handling || !get_is_implemented() ||
+        get_oam_dma_transfer() ||
+        get_next_event_cycle() != gb->jit.entry_deadline ||
+        get_block_mapping_generation() != gb->jit.block_generation) {
+        gb->jit.stop = true;
+    }
+}
+
+static uint8_t jit_read(uint16_t address, uint64_t cycle) {
+    gb->scheduler.cycles = cycle;
+    const uint8_t BYTE = get_memory_byte(address);
+    check_block_exit();
+    return BYTE;
+}
+
+static void jit_write(uint16_t address, uint8_t byte, uint64_t cycle) {
+    gb->scheduler.cycles = cycle;
+    set_memory_byte(address, byte);
+    check_block_exit();
+}
+
+static clock_cycles_t jit_call_handler(cached_instruction_t *cached,
+                                       uint64_t cycle) {
+    gb->scheduler.cycles = cycle;
+    const clock_cycles_t CLOCKS = run_cached_instruction(cached);
+    check_block_exit();
+    return CLOCKS;
+}
+
+// INC and DEC keep the carry flag, so a pending operation is stored first
+static void jit_store_flags(void) { set_register(F, get_register(F)); }
+
+// Reads the byte at the address in ecx into eax without the page tables
+static void emit_slow_read(code_buffer_t *buffer, uint8_t index) {
+    emit_u8(buffer, 0x89); // mov edi, ecx
+    emit_u8(buffer, 0xCF);
+    emit_visible_cycle(buffer, ESI, index);
+    emit_call(buffer, (uintptr_t)&jit_read);
+    emit_u8(buffer, 0x0F); // movzx eax, al
+    emit_u8(buffer, 0xB6);
+    emit_u8(buffer, 0xC0);
+    buffer->calls_out = true;
+}
+
+// Writes dl to the address in ecx without the page tables
+static void emit_slow_write(code_buffer_t *buffer, uint8_t index) {
+    emit_u8(buffer, 0x89); // mov edi, ecx
+    emit_u8(buffer, 0xCF);
+    emit_u8(buffer, 0x89); // mov esi, edx
+    emit_u8(buffer, 0xD6);
+    emit_visible_cycle(buffer, EDX, index);
+    emit_call(buffer, (uintptr_t)&jit_write);
+    buffer->calls_out = true;
+}
+
+// Reads the byte at the address in ecx into eax
+static void emit_read(code_buffer_t *buffer, uint8_t index) {
+    emit_u8(buffer, 0x89); // mov eax, ecx
+    emit_u8(buffer, 0xC8);
+    emit_u8(buffer, 0xC1); // shr eax, 8
+    emit_u8(buffer, 0xE8);
+    emit_u8(buffer, 0x08);
+    emit_u8(buffer, 0x49); // mov rdx, [r14 + rax * 8]
+    emit_u8(buffer, 0x8B);
+    emit_u8(buffer, 0x14);
+    emit_u8(buffer, 0xC6);
+    emit_u8(buffer, 0x48); // test rdx, rdx
+    emit_u8(buffer, 0x85);
+    emit_u8(buffer, 0xD2);
+    const size_t UNMAPPED = emit_forward_jump(buffer, JZ);
+    emit_u8(buffer, 0x0F); // movzx eax, cl
+    emit_u8(buffer, 0xB6);
+    emit_u8(buffer, 0xC1);
+    emit_u8(buffer, 0x0F); // movzx eax, byte [rdx + rax]
+    emit_u8(buffer, 0xB6);
+    emit_u8(buffer, 0x04);
+    emit_u8(buffer, 0x02);
+    const size_t DONE = emit_forward_jump(buffer, 0);
+    patch_jump(buffer, UNMAPPED);
+    emit_slow_read(buffer, index);
+    patch_jump(buffer, DONE);
+}
+
+// Writes dl to the address in ecx
+static void emit_write(code_buffer_t *buffer, uint8_t index) {
+    emit_u8(buffer, 0x89); // mov eax, ecx
+    emit_u8(buffer, 0xC8);
+    emit_u8(buffer, 0xC1); // shr eax, 8
+    emit_u8(buffer, 0xE8);
+    emit_u8(buffer, 0x08);
+    emit_u8(buffer, 0x49); // mov rax, [r15 + rax * 8]
+    emit_u8(buffer, 0x8B);
+    emit_u8(buffer, 0x04);
+    emit_u8(buffer, 0xC7);
+    emit_u8(buffer, 0x48); // test rax, rax
+    emit_u8(buffer, 0x85);
+    emit_u8(buffer, 0xC0);
+    const size_t UNMAPPED = emit_forward_jump(buffer, JZ);
+    emit_u8(buffer, 0x0F); // movzx ecx, cl
+    emit_u8(buffer, 0xB6);
+    emit_u8(buffer, 0xC9);
+    emit_u8(buffer, 0x88); // mov [rax + rcx], dl
+    emit_u8(buffer, 0x14);
+    emit_u8(buffer, 0x08);
+    const size_t DONE = emit_forward_jump(buffer, 0);
+    patch_jump(buffer, UNMAPPED);
+    emit_slow_write(buffer, index);
+    patch_jump(buffer, DONE);
+}
+
+// mov ecx, imm32
+static void emit_load_ecx(code_buffer_t *buffer, uint32_t val) {
+    emit_u8(buffer, 0xB9);
+    emit_u32(buffer, val);
+}
+
+// ADD, SUB, AND, XOR, OR and CP of A with ecx, ADC and SBC aren't emitted
+static void emit_alu(code_buffer_t *buffer, uint8_t operation) {
+    emit_load_register(buffer, EAX, A);
+    switch (operation) {
+        case 0: // ADD
+            emit_defer_flags(buffer, FLAGS_ADD, EAX, ECX);
+            emit_u8(buffer, 0x01); // add eax, ecx
+            emit_u8(buffer, 0xC8);
+            emit_store_register(buffer, EAX, A);
+            break;
+        case 2: // SUB
+            emit_defer_flags(buffer, FLAGS_SUB, EAX, ECX);
+            emit_u8(buffer, 0x29); // sub eax, ecx
+            emit_u8(buffer, 0xC8);
+            emit_store_register(buffer, EAX, A);
+            break;
+        case 4: // AND
+            emit_u8(buffer, 0x21); // and eax, ecx
+            emit_u8(buffer, 0xC8);
+            emit_store_register(buffer, EAX, A);
+            emit_set_flags(buffer, true);
+            break;
+        case 5: // XOR
+            emit_u8(buffer, 0x31); // xor eax, ecx
+            emit_u8(buffer, 0xC8);
+            emit_store_register(buffer, EAX, A);
+            emit_set_flags(buffer, false);
+            break;
+        case 6: // OR
+            emit_u8(buffer, 0x09); // or eax, ecx
+            emit_u8(buffer, 0xC8);
+            emit_store_register(buffer, EAX, A);
+            emit_set_flags(buffer, false);
+            break;
+        case 7: // CP
+            emit_defer_flags(buffer, FLAGS_SUB, EAX, ECX);
+            break;
+        default: break;
+    }
+}
+
+static bool is_native_alu_operation(uint8_t operation) {
+    return operation != 1 && operation != 3;
+}
+
+static void emit_inc_dec_register(code_buffer_t *buffer, reg_t reg,
+                                  bool increment) {
+    // cmp dword [operation], FLAGS_EVALUATED ; je skip ; call jit_store_flags
+    emit_u8(buffer, 0x83);
+    emit_hardware_operand(buffer, 7,
+                          offsetof(Hardware, lazy_flags) +
+                              offsetof(lazy_flags_t, operation));
+    emit_u8(buffer, FLAGS_EVALUATED);
+    emit_u8(buffer, 0x74);
+    emit_u8(buffer, 12);
+    emit_call(buffer, (uintptr_t)&jit_store_flags);
+    emit_load_register(buffer, EAX, reg);
+    emit_defer_flags(buffer, increment ? FLAGS_INC : FLAGS_DEC, EAX, -1);
+    emit_u8(buffer, 0xFF); // inc eax / dec eax
+    emit_u8(buffer, increment ? 0xC0 : 0xC8);
+    emit_store_register(buffer, EAX, reg);
+}
+
+/*
+ * Emits the inline version of the instruction at index in the block and
+ * returns the clocks its handler would have returned, or 0 if it has to go
+ * through the handler. Loads and stores leave calls_out set.
+ */
+static clock_cycles_t emit_native_instruction(
+    code_buffer_t *buffer, const cached_instruction_t *cached, uint8_t index) {
+    const uint8_t OPCODE = cached->instruction[0];
+    const uint16_t IMM16 =
+        two_u8s_to_u16(cached->instruction[1], cached->instruction[2]);
+    const long_reg_t PAIR = (OPCODE >> 4) & 0x3;
+    const reg_t DST = (OPCODE >> 3) & 0x7;
+    const reg_t SRC = OPCODE & 0x7;
+
+    switch (OPCODE) {
+        case 0x00: return FOUR_CLOCKS; // NOP
+        case 0x01:
+        case 0x11:
+        case 0x21: // LD rr, nn
+            // mov word [pair], imm16 with the high byte first
+            emit_u8(buffer, 0x66);
+            emit_u8(buffer, 0xC7);
+            emit_hardware_operand(buffer, 0,
+                                  register_offset((reg_t)(PAIR * 2)));
+            emit_u8(buffer, cached->instruction[2]);
+            emit_u8(buffer, cached->instruction[1]);
+            return TWELVE_CLOCKS;
+        case 0x02:
+        case 0x12: // LD (rr), A
+            emit_load_pair(buffer, ECX, PAIR);
+            emit_load_register(buffer, EDX, A);
+            emit_write(buffer, index);
+            return EIGHT_CLOCKS;
+        case 0x0A:
+        case 0x1A: // LD A, (rr)
+            emit_load_pair(buffer, ECX, PAIR);
+            emit_read(buffer, index);
+            emit_store_register(buffer, EAX, A);
+            return EIGHT_CLOCKS;
+        case 0x22:
+        case 0x32: // LD (HL+), A and LD (HL-), A
+            emit_load_pair(buffer, ECX, HL);
+            emit_load_register(buffer, EDX, A);
+            emit_write(buffer, index);
+            emit_step_pair(buffer, HL, OPCODE == 0x22);
+            return EIGHT_CLOCKS;
+        case 0x2A:
+        case 0x3A: // LD A, (HL+) and LD A, (HL-)
+            emit_load_pair(buffer, ECX, HL);
+            emit_read(buffer, index);
+            emit_store_register(buffer, EAX, A);
+            emit_step_pair(buffer, HL, OPCODE == 0x2A);
+            return EIGHT_CLOCKS;
+        case 0x03:
+        case 0x13:
+        case 0x23: // INC rr
+        case 0x0B:
+        case 0x1B:
+        case 0x2B: // DEC rr
+            emit_step_pair(buffer, PAIR, (OPCODE & 0x08) == 0);
+            return EIGHT_CLOCKS;
+        case 0x33:
+        case 0x3B: // INC SP and DEC SP
+            emit_u8(buffer, 0x66); // inc word [sp] / dec word [sp]
+            emit_u8(buffer, 0xFF);
+            emit_hardware_operand(buffer, OPCODE == 0x33 ? 0 : 1,
+                                  offsetof(Hardware, sp));
+            return EIGHT_CLOCKS;
+        case 0x36: // LD (HL), n
+            emit_load_pair(buffer, ECX, HL);
+            emit_u8(buffer, 0xBA); // mov edx, imm32
+            emit_u32(buffer, cached->instruction[1]);
+            emit_write(buffer, index);
+            return TWELVE_CLOCKS;
+        case 0xE0:
+        case 0xE2: // LDH (n), A and LD (C), A
+            if (OPCODE == 0xE0) {
+                emit_load_ecx(buffer, 0xFF00u | cached->instruction[1]);
+            } else {
+                emit_load_register(buffer, ECX, C);
+                emit_u8(buffer, 0x81); // or ecx, 0xFF00
+                emit_u8(buffer, 0xC9);
+                emit_u32(buffer, 0xFF00);
+            }
+            emit_load_register(buffer, EDX, A);
+            // IO and HRAM are never mapped
+            emit_slow_write(buffer, index);
+            return OPCODE == 0xE0 ? TWELVE_CLOCKS : EIGHT_CLOCKS;
+        case 0xF0:
+        case 0xF2: // LDH A, (n) and LD A, (C)
+            if (OPCODE == 0xF0) {
+                emit_load_ecx(buffer, 0xFF00u | cached->instruction[1]);
+            } else {
+                emit_load_register(buffer, ECX, C);
+                emit_u8(buffer, 0x81); // or ecx, 0xFF00
+                emit_u8(buffer, 0xC9);
+                emit_u32(buffer, 0xFF00);
+            }
+            emit_slow_read(buffer, index);
+            emit_store_register(buffer, EAX, A);
+            return OPCODE == 0xF0 ? TWELVE_CLOCKS : EIGHT_CLOCKS;
+        case 0xEA: // LD (nn), A
+            emit_load_ecx(buffer, IMM16);
+            emit_load_register(buffer, EDX, A);
+            emit_write(buffer, index);
+            return SIXTEEN_CLOCKS;
+        case 0xFA: // LD A, (nn)
+            emit_load_ecx(buffer, IMM16);
+            emit_read(buffer, index);
+            emit_store_register(buffer, EAX, A);
+            return SIXTEEN_CLOCKS;
+        case 0xC6:
+        case 0xD6:
+        case 0xE6:
+        case 0xEE:
+        case 0xF6:
+        case 0xFE:
+            // ALU A, n, SUB, AND and OR return 4 clocks from their handlers
+            emit_load_ecx(buffer, cached->instruction[1]);
+            emit_alu(buffer, DST);
+            return OPCODE == 0xD6 || OPCODE == 0xE6 || OPCODE == 0xF6
+                       ? FOUR_CLOCKS
+                       : EIGHT_CLOCKS;
+        default: break;
+    }
+
+    if ((OPCODE & 0xC6) == 0x04 && DST != F) { // INC r and DEC r
+        emit_inc_dec_register(buffer, DST, (OPCODE & 0x01) == 0);
+        return FOUR_CLOCKS;
+    }
+    if ((OPCODE & 0xC7) == 0x06 && DST != F) { // LD r, n
+        // mov byte [register], imm8
+        emit_u8(buffer, 0xC6);
+        emit_hardware_operand(buffer, 0, register_offset(DST));
+        emit_u8(buffer, cached->instruction[1]);
+        return EIGHT_CLOCKS;
+    }
+    if (OPCODE >= 0x40 && OPCODE < 0x80 && OPCODE != 0x76) {
+        // (HL) is encoded where F would be
+        if (SRC == F) {
+            emit_load_pair(buffer, ECX, HL);
+            emit_read(buffer, index);
+            emit_store_register(buffer, EAX, DST);
+            return EIGHT_CLOCKS;
+        }
+        if (DST == F) {
+            emit_load_pair(buffer, ECX, HL);
+            emit_load_register(buffer, EDX, SRC);
+            emit_write(buffer, index);
+            return EIGHT_CLOCKS;
+        }
+        emit_load_register(buffer, ECX, SRC);
+        emit_store_register(buffer, ECX, DST);
+        return FOUR_CLOCKS;
+    }
+    if (OPCODE >= 0x80 && OPCODE < 0xC0 && is_native_alu_operation(DST)) {
+        if (SRC == F) {
+            emit_load_pair(buffer, ECX, HL);
+            emit_read(buffer, index);
+            emit_u8(buffer, 0x89); // mov ecx, eax
+            emit_u8(buffer, 0xC1);
+            emit_alu(buffer, DST);
+            return EIGHT_CLOCKS;
+        }
+        emit_load_register(buffer, ECX, SRC);
+        emit_alu(buffer, DST);
+        return FOUR_CLOCKS;
+    }
+    return 0;
+}
+
+// add r13d, imm32
+static void emit_add_clocks(code_buffer_t *buffer, clock_cycles_t clocks) {
+    emit_u8(buffer, 0x41);
+    emit_u8(buffer, 0x81);
+    emit_u8(buffer, 0xC5);
+    emit_u32(buffer, (uint32_t)clocks);
+}
+
+// mov word [pc], imm16
+static void emit_set_pc(code_buffer_t *buffer, uint16_t pc) {
+    emit_u8(buffer, 0x66);
+    emit_u8(buffer, 0xC7);
+    emit_hardware_operand(buffer, 0, offsetof(Hardware, pc));
+    emit_u16(buffer, pc);
+}
+
+/*
+ * Leaves the block with the clocks run so far. Inline instructions count
+ * themselves here, the handlers count the rest.
+ */
+static void emit_exit(code_buffer_t *buffer, size_t epilogue,
+                      uint8_t native_instructions) {
+    if (native_instructions) {
+        // add qword [instruction_count], imm8
+        emit_u8(buffer, 0x48);
+        emit_u8(buffer, 0x83);
+        emit_hardware_operand(buffer, 0, offsetof(Hardware, instruction_count));
+        emit_u8(buffer, native_instructions);
+    }
+    emit_u8(buffer, 0x44); // mov eax, r13d
+    emit_u8(buffer, 0x89);
+    emit_u8(buffer, 0xE8);
+    emit_u8(buffer, 0xE9); // jmp epilogue
+    emit_u32(buffer, (uint32_t)(epilogue - (buffer->used + 4)));
+}
+
+// Leaves the block if a call out asked it to, see check_block_exit
+static void emit_stop_check(code_buffer_t *buffer, size_t epilogue,
+                            const cached_instruction_t *cached, bool set_pc,
+                            uint8_t native_instructions) {
+    emit_load_rax(buffer, &gb->jit.stop);
+    emit_u8(buffer, 0x80); // cmp byte [rax], 0
+    emit_u8(buffer, 0x38);
+    emit_u8(buffer, 0x00);
+    emit_u8(buffer, 0x74); // je past the exit
+    const size_t SKIP = buffer->used;
+    emit_u8(buffer, 0);
+    if (set_pc) {
+        emit_set_pc(buffer, (uint16_t)(cached->pc + cached->length));
+    }
+    emit_exit(buffer, epilogue, native_instructions);
+    buffer->code[SKIP] = (uint8_t)(buffer->used - SKIP - 1);
+}
+
+/*
+ * Emits JR, JP and their conditional versions, which only ever end a block.
+ * Sets PC and adds the clocks of whichever way the jump went.
+ */
+static bool emit_native_jump(code_buffer_t *buffer,
+                             const cached_instruction_t *cached) {
+    const uint8_t OPCODE = cached->instruction[0];
+    const uint16_t NEXT_PC = (uint16_t)(cached->pc + cached->length);
+    const bool RELATIVE = OPCODE < 0x40;
+    const uint16_t TARGET =
+        RELATIVE ? (uint16_t)(NEXT_PC + uint8_to_int8(cached->instruction[1]))
+                 : two_u8s_to_u16(cached->instruction[1],
+                                  cached->instruction[2]);
+    const clock_cycles_t TAKEN = RELATIVE ? TWELVE_CLOCKS : SIXTEEN_CLOCKS;
+    const clock_cycles_t NOT_TAKEN = RELATIVE ? EIGHT_CLOCKS : TWELVE_CLOCKS;
+
+    switch (OPCODE) {
+        case 0x18:
+        case 0xC3: // JR e and JP nn
+            emit_set_pc(buffer, TARGET);
+            emit_add_clocks(buffer, TAKEN);
+            return true;
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38: // JR cc, e
+        case 0xC2:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA: // JP cc, nn
+            break;
+        default: return false;
+    }
+
+    // NZ, Z, NC and C in bits 3 and 4
+    const uint8_t CONDITION = (OPCODE >> 3) & 0x3;
+    emit_u8(buffer, 0xBF); // mov edi, flag
+    emit_u32(buffer, CONDITION < 2 ? Z_FLAG : C_FLAG);
+    emit_call(buffer, (uintptr_t)&get_flag);
+    emit_u8(buffer, 0x84); // test al, al
+    emit_u8(buffer, 0xC0);
+    const size_t NOT_TAKEN_JUMP =
+        emit_forward_jump(buffer, CONDITION & 0x1 ? JZ : JNZ);
+    emit_set_pc(buffer, TARGET);
+    emit_add_clocks(buffer, TAKEN);
+    const size_t DONE = emit_forward_jump(buffer, 0);
+    patch_jump(buffer, NOT_TAKEN_JUMP);
+    emit_set_pc(buffer, NEXT_PC);
+    emit_add_clocks(buffer, NOT_TAKEN);
+    patch_jump(buffer, DONE);
+    return true;
+}
+
+static native_block_t compile_block(basic_block_t *block) {
+    code_buffer_t buffer = {.code = gb->jit.arena + gb->jit.arena_used,
+                            .used = 0,
+                            .size = JIT_ARENA_SIZE - gb->jit.arena_used};
+    size_t epilogue;
+    size_t entry;
+    uint8_t native_instructions = 0;
+    uint32_t clocks_before_last = 0;
+
+    // Exit path sits in front of the entry point so every jump to it is
+    // backwards and needs no patching
+    epilogue = buffer.used;
+    emit_u8(&buffer, 0x41); // pop r15
+    emit_u8(&buffer, 0x5F);
+    emit_u8(&buffer, 0x41); // pop r14
+    emit_u8(&buffer, 0x5E);
+    emit_u8(&buffer, 0x41); // pop r13
+    emit_u8(&buffer, 0x5D);
+    emit_u8(&buffer, 0x41); // pop r12
+    emit_u8(&buffer, 0x5C);
+    emit_u8(&buffer, 0x5B); // pop rbx
+    emit_u8(&buffer, 0xC3); // ret
+    entry = buffer.used;
+    // Five pushes keep the stack 16 byte aligned for calls
+    emit_u8(&buffer, 0x53); // push rbx
+    emit_u8(&buffer, 0x41); // push r12
+    emit_u8(&buffer, 0x54);
+    emit_u8(&buffer, 0x41); // push r13
+    emit_u8(&buffer, 0x55);
+    emit_u8(&buffer, 0x41); // push r14
+    emit_u8(&buffer, 0x56);
+    emit_u8(&buffer, 0x41); // push r15
+    emit_u8(&buffer, 0x57);
+    emit_u8(&buffer, 0x48); // mov rbx, &hardware
+    emit_u8(&buffer, 0xBB);
+    emit_u64(&buffer, (uint64_t)(uintptr_t)get_hardware());
+    emit_u8(&buffer, 0x49); // mov r12, rdi
+    emit_u8(&buffer, 0x89);
+    emit_u8(&buffer, 0xFC);
+    emit_u8(&buffer, 0x45); // xor r13d, r13d
+    emit_u8(&buffer, 0x31);
+    emit_u8(&buffer, 0xED);
+    emit_u8(&buffer, 0x49); // mov r14, read_pages
+    emit_u8(&buffer, 0xBE);
+    emit_u64(&buffer, (uint64_t)(uintptr_t)gb->memory.read_pages);
+    emit_u8(&buffer, 0x49); // mov r15, write_pages
+    emit_u8(&buffer, 0xBF);
+    emit_u64(&buffer, (uint64_t)(uintptr_t)gb->memory.write_pages);
+
+    for (uint8_t i = 0; i < block->instruction_count; i++) {
+        cached_instruction_t *cached = &block->instructions[i];
+        const bool LAST = i + 1 == block->instruction_count;
+        clock_cycles_t clocks;
+        if (buffer.size - buffer.used < MAX_EMITTED_INSTRUCTION_SIZE) {
+            return NULL;
+        }
+        buffer.calls_out = false;
+        if (EMIT_INLINE && LAST && emit_native_jump(&buffer, cached)) {
+            native_instructions++;
+            emit_exit(&buffer, epilogue, native_instructions);
+            break;
+        }
+        clocks = EMIT_INLINE ? emit_native_instruction(&buffer, cached, i) : 0;
+        if (clocks) {
+            native_instructions++;
+            emit_add_clocks(&buffer, clocks);
+            if (LAST) {
+                emit_set_pc(&buffer, (uint16_t)(cached->pc + cached->length));
+                emit_exit(&buffer, epilogue, native_instructions);
+            } else if (buffer.calls_out) {
+                emit_stop_check(&buffer, epilogue, cached, true,
+                                native_instructions);
+            }
+        } else {
+            // mov rdi, cached ; call jit_call_handler ; add r13d, eax
+            emit_u8(&buffer, 0x48);
+            emit_u8(&buffer, 0xBF);
+            emit_u64(&buffer, (uint64_t)(uintptr_t)cached);
+            emit_visible_cycle(&buffer, ESI, i);
+            emit_call(&buffer, (uintptr_t)&jit_call_handler);
+            emit_u8(&buffer, 0x41);
+            emit_u8(&buffer, 0x01);
+            emit_u8(&buffer, 0xC5);
+            if (LAST) {
+                emit_exit(&buffer, epilogue, native_instructions);
+            } else {
+                emit_stop_check(&buffer, epilogue, cached, false,
+                                native_instructions);
+            }
+        }
+        if (!LAST) {
+            const opcode_info_t *opcode_info =
+                decode_opcode(cached->instruction[0], cached->instruction[1]);
+            clocks_before_last += (uint32_t)opcode_info->cycles;
+        }
+    }
+
+    block->clocks_before_last = (uint16_t)clocks_before_last;
+    gb->jit.arena_used += buffer.used;
+    gb->jit.stats.native_instructions += native_instructions;
+    return (native_block_t)(uintptr_t)(buffer.code + entry);
+}
+
+// The arena is only writable while a block is being compiled
+static bool set_arena_writable(bool writable) {
+    return mprotect(gb->jit.arena, JIT_ARENA_SIZE,
+                    writable ? PROT_READ | PROT_WRITE
+                             : PROT_READ | PROT_EXEC) == 0;
+}
+#endif
+
+// Keeps the blocks compiled so far when called again
+bool initialize_jit(void) {
+#ifdef JIT_SUPPORTED
+    if (gb->jit.arena) {
+        return true;
+    }
+    gb->jit.arena = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (gb->jit.arena == MAP_FAILED) {
+        gb->jit.arena = NULL;
+        return false;
+    }
+    gb->jit.arena_used = 0;
+    memset(&gb->jit.stats, 0, sizeof(gb->jit.stats));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void destroy_jit(void) {
+#ifdef JIT_SUPPORTED
+    if (gb->jit.arena) {
+        munmap(gb->jit.arena, JIT_ARENA_SIZE);
+        gb->jit.arena = NULL;
+    }
+#endif
+}
+
+#ifdef JIT_SUPPORTED
+// Whether the block has native code, compiling it once it's hot enough
+static bool compile_hot_block(basic_block_t *block) {
+    if (block->native) {
+        return true;
+    }
+    if (block->native_failed ||
+        ++block->execution_count < JIT_HOT_THRESHOLD) {
+        return false;
+    }
+    if (set_arena_writable(true)) {
+        block->native = compile_block(block);
+        if (!set_arena_writable(false)) {
+            block->native = NULL;
+        }
+    }
+    if (!block->native) {
+        block->native_failed = true;
+        gb->jit.stats.compile_failures++;
+        return false;
+    }
+    gb->jit.stats.blocks_compiled++;
+    return true;
+}
+#endif
+
+/*
+ * Runs the compiled block starting at PC if there is one and returns the
+ * clocks it took, which step_cpu retires along with the clocks in front of
+ * it. The first instruction sees the current cycle and every later one sees
+ * the current cycle plus the clocks in front of the block plus the clocks of
+ * the instructions before it, which is exactly where the interpreter would
+ * have been. Returns INVALID_CLOCKS when the instruction at PC should go
+ * through the block cache instead.
+ */
+clock_cycles_t execute_jit_block(clock_cycles_t clocks) {
+#ifdef JIT_SUPPORTED
+    uint16_t pc = get_pc();
+    if (!gb->jit.arena || gb->cpu.step_mode || block_cursor_continues(pc)) {
+        return INVALID_CLOCKS;
+    }
+    basic_block_t *block = lookup_block(pc);
+    if (!block) {
+        return INVALID_CLOCKS;
+    }
+    if (!compile_hot_block(block)) {
+        set_block_cursor(block);
+        return INVALID_CLOCKS;
+    }
+    const uint64_t NOW = get_cycles();
+    const clock_cycles_t SKIPPED = skip_idle_loop(block);
+    gb->jit.entry_deadline = get_next_event_cycle();
+    if (NOW + (uint64_t)(clocks + SKIPPED) + block->clocks_before_last >=
+        gb->jit.entry_deadline) {
+        // An event comes due inside the block, so it is stepped instead
+        gb->jit.stats.deadline_fallbacks++;
+        set_block_cursor(block);
+        return SKIPPED + execute_cached_instruction();
+    }
+    gb->jit.stats.block_hits++;
+    gb->jit.block_generation = get_block_mapping_generation();
+    gb->jit.stop = false;
+    set_block_cursor(NULL);
+    const uint32_t BLOCK_CLOCKS =
+        block->native(NOW + (uint64_t)(clocks + SKIPPED));
+    gb->scheduler.cycles = NOW;
+    if (gb->jit.stop) {
+        gb->jit.stats.early_exits++;
+    }
+    return SKIPPED + (clock_cycles_t)BLOCK_CLOCKS;
+#else
+    (void)clocks;
+    return INVALID_CLOCKS;
+#endif
+}
+
+jit_stats_t get_jit_stats(void) { return gb->jit.stats; }
+
+void print_jit_stats(void) {
+    fprintf(stderr,
+            "JIT: %" PRIu64 " blocks compiled, %" PRIu64 " block hits, %" PRIu64
+            " inline instructions, %" PRIu64 " early exits, %" PRIu64
+            " blocks stepped for events, %" PRIu64 " compile failures\n",
+            gb->jit.stats.blocks_compiled, gb->jit.stats.block_hits,
+            gb->jit.stats.native_instructions, gb->jit.stats.early_exits,
+            gb->jit.stats.deadline_fallbacks, gb->jit.stats.compile_failures);
+}
@@ -1,7 +1,11 @@
 #include "memory.h"
-#include "graphics.h"
+#include "block_cache.h"
+#include "context.h"
 #include "hardware.h"
+#include "interrupts.h"
+#include "oam_queue.h"
 #include "ppu.h"
+#include "tile_cache.h"
 #include "utils.h"
 #include <errno.h>
 #include <inttypes.h>
@@ -10,57 +14,51 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-static MBC mbc;
-static bool dmg_mapped = false;
-static uint8_t *dmg = NULL;
-static uint8_t *vram = NULL;
-static uint8_t *wram = NULL;
-static uint8_t *oam = NULL;
-static uint8_t *io_ram = NULL;
-#define SAVE_DIR "saves"
-static char save_location_filename[MAX_SAVE_DATA_NAME_SIZE];
-
-static CartridgeHeader decode_cartridge_header(FILE *rom);
-
-void initialize_memory(CartridgeHeader ch) {
-    vram = calloc(0x9FFF - 0x7FFF, sizeof(uint8_t));
-    if (!vram) {
+static bool decode_cartridge_header(FILE *rom, CartridgeHeader *ch);
+static void map_memory_pages(void);
+static void map_cartridge_pages(void);
+
+bool initialize_memory(CartridgeHeader ch) {
+    switch (ch.cartridge_type) {
+        case 0x00: gb->memory.mbc = initialize_mbc0(); break;
+        case 0x01: gb->memory.mbc = initialize_mbc1(ch); break;
+        case 0x02: gb->memory.mbc = initialize_mbc1(ch); break;
+        case 0x03: gb->memory.mbc = initialize_mbc1(ch); break;
+        case 0x0F:
+        case 0x10:
+        case 0x11:
+        case 0x12:
+        case 0x13: gb->memory.mbc = initialize_mbc3(ch); break;
+        default:
+            fprintf(stderr, "Cartridge type not implemented: %d\n",
+                    ch.cartridge_type);
+            return false;
+    }
+
+    gb->memory.vram = calloc(0x9FFF - 0x7FFF, sizeof(uint8_t));
+    if (!gb->memory.vram) {
         fprintf(stderr, "Unable to allocate memory for VRAM");
         exit(1);
     }
-    wram = calloc(0xDFFF - 0xBFFF, sizeof(uint8_t));
-    if (!wram) {
+    gb->memory.wram = calloc(0xDFFF - 0xBFFF, sizeof(uint8_t));
+    if (!gb->memory.wram) {
         fprintf(stderr, "Unable to allocate memory for WRAM");
         exit(1);
     }
 
-    oam = calloc(0xFE9F - 0xFDFF, sizeof(uint8_t));
-    if (!oam) {
+    gb->memory.oam = calloc(0xFE9F - 0xFDFF, sizeof(uint8_t));
+    if (!gb->memory.oam) {
         fprintf(stderr, "Unable to allocate memory for memory");
         exit(1);
     }
 
-    io_ram = calloc(0xFFFF - 0xFE9F, sizeof(uint8_t));
-    if (!io_ram) {
+    gb->memory.io_ram = calloc(0xFFFF - 0xFE9F, sizeof(uint8_t));
+    if (!gb->memory.io_ram) {
         fprintf(stderr, "Unable to allocate memory for memory");
         exit(1);
     }
 
-    switch (ch.cartridge_type) {
-        case 0x00: mbc = initialize_mbc0(); return;
-        case 0x01: mbc = initialize_mbc1(ch); return;
-        case 0x02: mbc = initialize_mbc1(ch); return;
-        case 0x03: mbc = initialize_mbc1(ch); return;
-        case 0x0F:
-        case 0x10:
-        case 0x11:
-        case 0x12:
-        case 0x13: mbc = initialize_mbc3(ch); return;
-        default:
-            fprintf(stderr, "Cartridge type not implemented: %d\n",
-                    ch.cartridge_type);
-            exit(1);
-    }
+    return true;
 
 #ifdef SKIP_BOOT
     privileged_set_memory_byte(JOYP, 0xCF);
@@ -95,105 +93,202 @@ void initialize_memory(CartridgeHeader ch) {
 }
 
 void destroy_memory(void) {
-    if (vram) {
-        free(vram);
-        vram = NULL;
+    memset(gb->memory.read_pages, 0, sizeof(gb->memory.read_pages));
+    memset(gb->memory.write_pages, 0, sizeof(gb->memory.write_pages));
+    if (gb->memory.vram) {
+        free(gb->memory.vram);
+        gb->memory.vram = NULL;
     }
-    if (wram) {
-        free(wram);
-        wram = NULL;
+    if (gb->memory.wram) {
+        free(gb->memory.wram);
+        gb->memory.wram = NULL;
     }
-    if (oam) {
-        free(oam);
-        oam = NULL;
+    if (gb->memory.oam) {
+        free(gb->memory.oam);
+        gb->memory.oam = NULL;
     }
-    if (io_ram) {
-        free(io_ram);
-        io_ram = NULL;
+    if (gb->memory.io_ram) {
+        free(gb->memory.io_ram);
+        gb->memory.io_ram = NULL;
     }
-    if (mbc.destroy_memory) {
-        mbc.destroy_memory();
+    if (gb->memory.mbc.destroy_memory) {
+        gb->memory.mbc.destroy_memory();
     }
+    memset(&gb->memory.mbc, 0, sizeof(gb->memory.mbc));
 }
 
-static CartridgeHeader decode_cartridge_header(FILE *rom) {
+static bool decode_cartridge_header(FILE *rom, CartridgeHeader *ch) {
     uint8_t buffer[0x50];
     fseek(rom, 0x100, SEEK_SET);
     fread(buffer, 0x50, 1, rom);
-    CartridgeHeader ch;
 
-    strncpy(ch.title, (char *)&buffer[0x34], MAX_TITLE_SIZE);
-    ch.title[MAX_TITLE_SIZE] = '\0';
+    strncpy(ch->title, (char *)&buffer[0x34], MAX_TITLE_SIZE);
+    ch->title[MAX_TITLE_SIZE] = '\0';
 
-    ch.cartridge_type = buffer[0x47];
-    ch.rom_banks = (uint16_t)(1 << (buffer[0x48] + 1));
+    ch->cartridge_type = buffer[0x47];
+    ch->rom_banks = (uint16_t)(1 << (buffer[0x48] + 1));
     switch (buffer[0x49]) {
-        case 0: ch.ram_banks = 0; break;
-        case 0x01: ch.ram_banks = 0; break;
-        case 0x02: ch.ram_banks = 1; break;
-        case 0x03: ch.ram_banks = 4; break;
-        case 0x04: ch.ram_banks = 16; break;
-        case 0x05: ch.ram_banks = 8; break;
+        case 0: ch->ram_banks = 0; break;
+        case 0x01: ch->ram_banks = 0; break;
+        case 0x02: ch->ram_banks = 1; break;
+        case 0x03: ch->ram_banks = 4; break;
+        case 0x04: ch->ram_banks = 16; break;
+        case 0x05: ch->ram_banks = 8; break;
         default:
             fprintf(stderr, "Invalid RAM size code in cartridge header\n");
-            exit(1);
+            return false;
     }
     fseek(rom, 0x0, SEEK_SET);
-    update_window_title(ch.title);
-    return ch;
+    memcpy(gb->memory.cartridge_title, ch->title,
+           sizeof(gb->memory.cartridge_title));
+    return true;
 }
 
-void map_dmg(void) {
-#ifdef SKIP_BOOT
-    return;
-#endif
-    dmg = calloc(DMG_SIZE, sizeof(uint8_t));
-    if (!dmg) {
+void map_dmg(const uint8_t *boot_rom) {
+    gb->memory.dmg = calloc(DMG_SIZE, sizeof(uint8_t));
+    if (!gb->memory.dmg) {
         fprintf(stderr, "Unable to allocate memory for memory");
         exit(1);
     }
-    FILE *dmg_file = fopen("dmg.bin", "r");
-    if (!dmg_file) {
-        fprintf(stderr, "No dmg present\n");
-        exit(1);
+    memcpy(&gb->memory.dmg[BOOT_ROM_BEGIN], boot_rom, DMG_SIZE);
+    gb->memory.dmg_mapped = true;
+}
+
+bool is_dmg_mapped(void) { return gb->memory.dmg_mapped; }
+
+const char *get_cartridge_title(void) { return gb->memory.cartridge_title; }
+
+uint16_t get_rom_bank(uint16_t address) {
+    return gb->memory.mbc.get_rom_bank(address);
+}
+
+void unmap_dmg(void) {
+    gb->memory.dmg_mapped = false;
+    if (gb->memory.dmg) {
+        free(gb->memory.dmg);
+        gb->memory.dmg = NULL;
     }
-    unsigned long bytes_read =
-        fread(&dmg[BOOT_ROM_BEGIN], DMG_SIZE, 1, dmg_file);
-    if (bytes_read != 1) {
-        fprintf(stderr, "Unable To Read DMG, %d\n", (int)bytes_read);
-        exit(1);
+    map_cartridge_pages();
+}
+
+static void map_pages(uint8_t **pages, uint16_t base, uint16_t end,
+                      uint8_t *memory) {
+    for (uint32_t address = base; address < end; address += MEMORY_PAGE_SIZE) {
+        pages[address / MEMORY_PAGE_SIZE] =
+            memory ? &memory[address - base] : NULL;
     }
-    dmg_mapped = true;
-    fclose(dmg_file);
-    return;
 }
 
-void unmap_dmg(void) {
-    dmg_mapped = false;
-    if (dmg) {
-        free(dmg);
-        dmg = NULL;
+static void map_cartridge_pages(void) {
+    Memory *memory = &gb->memory;
+    if (memory->bus_blocked) {
+        // Mapped again once the bus is free
+        return;
+    }
+    uint8_t *ex_ram = memory->mbc.get_bank_memory(EX_RAM_BASE);
+    map_pages(memory->read_pages, ROM_BANK_00_BASE, ROM_BANK_NN_BASE,
+              memory->mbc.get_bank_memory(ROM_BANK_00_BASE));
+    map_pages(memory->read_pages, ROM_BANK_NN_BASE, VRAM_BASE,
+              memory->mbc.get_bank_memory(ROM_BANK_NN_BASE));
+    map_pages(memory->read_pages, EX_RAM_BASE, WRAM_BASE, ex_ram);
+    map_pages(memory->write_pages, EX_RAM_BASE, WRAM_BASE, ex_ram);
+    if (memory->dmg_mapped) {
+        memory->read_pages[BOOT_ROM_BEGIN / MEMORY_PAGE_SIZE] = memory->dmg;
+    }
+}
+
+static void map_memory_pages(void) {
+    Memory *memory = &gb->memory;
+    if (memory->bus_blocked) {
+        return;
     }
+    map_cartridge_pages();
+    map_pages(memory->read_pages, WRAM_BASE, ECHO_RAM_BASE, memory->wram);
+    map_pages(memory->write_pages, WRAM_BASE, ECHO_RAM_BASE, memory->wram);
+    map_pages(memory->read_pages, ECHO_RAM_BASE, OAM_BASE, memory->wram);
+    map_pages(memory->write_pages, ECHO_RAM_BASE, OAM_BASE, memory->wram);
 }
 
-void load_rom(FILE *rom) {
-    CartridgeHeader ch = decode_cartridge_header(rom);
-    initialize_memory(ch);
-    uint32_t hash = mbc.load_rom(rom);
-    snprintf(save_location_filename, MAX_SAVE_DATA_NAME_SIZE - 1,
-             SAVE_DIR "/%s-%" PRIu32 ".sav", ch.title, hash);
-    save_location_filename[MAX_SAVE_DATA_NAME_SIZE - 1] = '\0';
-    load_save_data(save_location_filename);
-    map_dmg();
+/*
+ * Unmapping every page while the bus is blocked keeps the check off the fast
+ * path, all accesses go through the unmapped handlers and those drop them.
+ */
+void set_memory_bus_blocked(bool blocked) {
+    gb->memory.bus_blocked = blocked;
+    if (blocked) {
+        memset(gb->memory.read_pages, 0, sizeof(gb->memory.read_pages));
+        memset(gb->memory.write_pages, 0, sizeof(gb->memory.write_pages));
+    } else {
+        map_memory_pages();
+    }
+}
+
+/*
+ * The memory OAM DMA copies from, NULL if the page isn't plain memory and has
+ * to be read a byte at a time. Above WRAM it reads WRAM again like the echo.
+ */
+const uint8_t *get_oam_dma_source(uint8_t page) {
+    const uint16_t ADDRESS = (uint16_t)(page << 8);
+    if (ADDRESS >= VRAM_BASE && ADDRESS < EX_RAM_BASE) {
+        return &gb->memory.vram[ADDRESS - VRAM_BASE];
+    } else if (ADDRESS >= ECHO_RAM_BASE) {
+        return &gb->memory.wram[ADDRESS - 0x2000 - WRAM_BASE];
+    }
+    return gb->memory.read_pages[page];
+}
+
+/*
+ * Starts straight from the state the boot ROM leaves behind if there's no
+ * boot ROM and only touches the save directory if there is one. Nothing is
+ * set up if the cartridge can't be loaded.
+ */
+bool load_rom(FILE *rom, const uint8_t *boot_rom, const char *save_directory) {
+    CartridgeHeader ch;
+    if (!decode_cartridge_header(rom, &ch) || !initialize_memory(ch)) {
+        return false;
+    }
+    uint32_t hash = gb->memory.mbc.load_rom(rom);
+    if (save_directory) {
+        snprintf(gb->memory.save_directory, MAX_SAVE_DATA_NAME_SIZE, "%s",
+                 save_directory);
+        snprintf(gb->memory.save_location_filename, MAX_SAVE_DATA_NAME_SIZE,
+                 "%s/%s-%" PRIu32 ".sav", save_directory, ch.title, hash);
+        load_save_data(gb->memory.save_location_filename);
+    }
+    if (boot_rom) {
+        map_dmg(boot_rom);
+    } else {
+        skip_boot_rom();
+    }
+    map_memory_pages();
+    return true;
+}
+
+// The render worker keeps its own copy of everything the pixels depend on
+static void forward_to_render_worker(uint16_t address, uint8_t byte) {
+    if (gb->ppu.render_worker) {
+        log_render_write(address, byte);
+    }
 }
 
 void privileged_set_memory_byte(uint16_t address, uint8_t byte) {
     if (address >= VRAM_BASE && address < EX_RAM_BASE) {
-        vram[address - VRAM_BASE] = byte;
+        gb->memory.vram[address - VRAM_BASE] = byte;
+        invalidate_tile(address);
+        forward_to_render_worker(address, byte);
     } else if (address >= OAM_BASE && address < PROHIBITED_BASE) {
-        oam[address - OAM_BASE] = byte;
+        gb->memory.oam[address - OAM_BASE] = byte;
+        forward_to_render_worker(address, byte);
     } else if (address >= IO_RAM_BASE && address <= IE) {
-        io_ram[address - IO_RAM_BASE] = byte;
+        gb->memory.io_ram[address - IO_RAM_BASE] = byte;
+        if (address >= LCDC && address <= WX) {
+            update_ppu_register(address, byte);
+            forward_to_render_worker(address, byte);
+        } else if (address == IF) {
+            set_interrupt_flags(byte);
+        } else if (address == IE) {
+            set_interrupt_enable(byte);
+        }
     } else {
         fprintf(stderr, "Invalid privileged memory access\n");
         exit(1);
@@ -202,11 +297,11 @@ void privileged_set_memory_byte(uint16_t address, uint8_t byte) {
 
 uint8_t privileged_get_memory_byte(uint16_t address) {
     if (address >= VRAM_BASE && address < EX_RAM_BASE) {
-        return vram[address - VRAM_BASE];
+        return gb->memory.vram[address - VRAM_BASE];
     } else if (address >= OAM_BASE && address < PROHIBITED_BASE) {
-        return oam[address - OAM_BASE];
+        return gb->memory.oam[address - OAM_BASE];
     } else if (address >= IO_RAM_BASE && address <= IE) {
-        return io_ram[address - IO_RAM_BASE];
+        return gb->memory.io_ram[address - IO_RAM_BASE];
     } else {
         return get_memory_byte(address);
     }
@@ -220,12 +315,13 @@ void set_long_mem(uint16_t address, uint16_t val) {
 }
 
 static uint8_t handle_io_read(uint16_t address) {
+    const uint8_t *io_ram = gb->memory.io_ram;
     switch (address) {
         case JOYP: return io_ram[address - IO_RAM_BASE] | 0xA0;
         case SB: return io_ram[address - IO_RAM_BASE];
         case SC: return io_ram[address - IO_RAM_BASE] | 0xFF;
-        case DIV: return io_ram[address - IO_RAM_BASE];
-        case TIMA: return io_ram[address - IO_RAM_BASE];
+        case DIV: return read_timer_register(address);
+        case TIMA: return read_timer_register(address);
         case TMA: return io_ram[address - IO_RAM_BASE];
         case TAC: return io_ram[address - IO_RAM_BASE] | 0xF8;
         case IF: return io_ram[address - IO_RAM_BASE] | 0xE0;
@@ -238,10 +334,12 @@ static uint8_t handle_io_read(uint16_t address) {
         case NR44: return io_ram[address - IO_RAM_BASE] | 0x3F;
         case NR52: return io_ram[address - IO_RAM_BASE] | 0x70;
         case LCDC: return io_ram[address - IO_RAM_BASE];
-        case STAT: return io_ram[address - IO_RAM_BASE] | 0x80;
+        case STAT:
+            catch_up_ppu();
+            return io_ram[address - IO_RAM_BASE] | 0x80;
         case SCY: return io_ram[address - IO_RAM_BASE];
         case SCX: return io_ram[address - IO_RAM_BASE];
-        case LCDY: return io_ram[address - IO_RAM_BASE];
+        case LCDY: catch_up_ppu(); return io_ram[address - IO_RAM_BASE];
         case LYC: return io_ram[address - IO_RAM_BASE];
         case BGP: return io_ram[address - IO_RAM_BASE];
         case OBP0: return io_ram[address - IO_RAM_BASE];
@@ -263,30 +361,35 @@ static uint8_t handle_io_read(uint16_t address) {
     }
 }
 
-uint8_t get_memory_byte(uint16_t address) {
-    if (dmg_mapped && address >= 0x00 && address < 0x100) {
-        return dmg[address];
+static uint8_t read_unmapped_byte(uint16_t address) {
+    if (gb->memory.bus_blocked && address < IO_RAM_BASE) {
+        return 0xFF;
+    }
+    if (gb->memory.dmg_mapped && address >= 0x00 && address < 0x100) {
+        return gb->memory.dmg[address];
     }
     if (address >= ROM_BANK_00_BASE && address < ROM_BANK_NN_BASE) {
-        return mbc.get_memory_byte(address);
+        return gb->memory.mbc.get_memory_byte(address);
     } else if (address >= ROM_BANK_NN_BASE && address < VRAM_BASE) {
-        return mbc.get_memory_byte(address);
+        return gb->memory.mbc.get_memory_byte(address);
     } else if (address >= VRAM_BASE && address < EX_RAM_BASE) {
-        if (ppu.mode == 3) {
+        catch_up_ppu();
+        if (gb->ppu.mode == 3) {
             return 0xFF;
         }
-        return vram[address - VRAM_BASE];
+        return gb->memory.vram[address - VRAM_BASE];
     } else if (address >= EX_RAM_BASE && address < WRAM_BASE) {
-        return mbc.get_memory_byte(address);
+        return gb->memory.mbc.get_memory_byte(address);
     } else if (address >= WRAM_BASE && address < ECHO_RAM_BASE) {
-        return wram[address - WRAM_BASE];
+        return gb->memory.wram[address - WRAM_BASE];
     } else if (address >= ECHO_RAM_BASE && address < OAM_BASE) {
-        return wram[address - 0x2000 - WRAM_BASE];
+        return gb->memory.wram[address - 0x2000 - WRAM_BASE];
     } else if (address >= OAM_BASE && address < PROHIBITED_BASE) {
-        if (ppu.mode == 2 || ppu.mode == 3) {
+        catch_up_ppu();
+        if (gb->ppu.mode == 2 || gb->ppu.mode == 3) {
             return 0xFF;
         }
-        return oam[address - OAM_BASE];
+        return gb->memory.oam[address - OAM_BASE];
     } else if (address >= PROHIBITED_BASE && address < IO_RAM_BASE) {
         uint8_t current_mode = get_mode();
         if (current_mode == 3 || current_mode == 2) {
@@ -296,15 +399,59 @@ uint8_t get_memory_byte(uint16_t address) {
     } else if (address >= IO_RAM_BASE && address < HRAM_BASE) {
         return handle_io_read(address);
     } else if (address >= HRAM_BASE) {
-        return io_ram[address - IO_RAM_BASE];
+        return gb->memory.io_ram[address - IO_RAM_BASE];
     }
 
     fprintf(stderr, "Unhandled memory read\n");
     exit(1);
 }
 
+uint8_t get_memory_byte(uint16_t address) {
+    const uint8_t *page = gb->memory.read_pages[address / MEMORY_PAGE_SIZE];
+    if (page) {
+        return page[address % MEMORY_PAGE_SIZE];
+    }
+    return read_unmapped_byte(address);
+}
+
+static void handle_ppu_register_write(uint16_t address, uint8_t byte) {
+    uint8_t *io_ram = gb->memory.io_ram;
+    uint16_t address_offset = address - IO_RAM_BASE;
+    // Everything the PPU drew up to now used the old value
+    sync_ppu();
+    switch (address) {
+        case STAT: io_ram[address_offset] |= update_stat_register(byte); break;
+        case LCDC: {
+            uint8_t old_lcdc = io_ram[address_offset];
+            if (get_bit(old_lcdc, 7) == 1 && get_bit(byte, 7) == 0) {
+                gb->ppu.mode = 0;
+                gb->ppu.current_scan_line = 0;
+                set_memory_byte(LCDY, 0);
+                gb->ppu.line_x = 0;
+                gb->ppu.current_window_line = 0;
+                gb->ppu.window_rendered = false;
+                gb->ppu.line_dots = 0;
+            }
+            io_ram[address_offset] = byte;
+            break;
+        }
+        case DMA:
+            io_ram[address_offset] = byte;
+            start_oam_dma_transfer();
+            break;
+        default: io_ram[address_offset] = byte; break;
+    }
+    update_ppu_register(address, io_ram[address_offset]);
+    forward_to_render_worker(address, io_ram[address_offset]);
+}
+
 static void handle_io_write(uint16_t address, uint8_t byte) {
+    uint8_t *io_ram = gb->memory.io_ram;
     uint16_t address_offset = address - IO_RAM_BASE;
+    if (address >= LCDC && address <= WX) {
+        handle_ppu_register_write(address, byte);
+        return;
+    }
     switch (address) {
         case JOYP:
             if (get_bit(~byte, 4)) {
@@ -321,54 +468,59 @@ static void handle_io_write(uint16_t address, uint8_t byte) {
             if (byte > 0) {
                 unmap_dmg();
                 io_ram[address_offset] = byte;
-                return;
             }
-        case DIV: io_ram[address_offset] = 0; return;
-        case STAT: io_ram[address_offset] |= update_stat_register(byte); return;
-        case TIMA: io_ram[address_offset] += 1; return;
-        case LCDC: {
-            uint8_t old_lcdc = io_ram[address_offset];
-            if (get_bit(old_lcdc, 7) == 1 && get_bit(byte, 7) == 0) {
-                ppu.mode = 0;
-                ppu.current_scan_line = 0;
-                set_memory_byte(LCDY, 0);
-                ppu.line_x = 0;
-                ppu.current_window_line = 0;
-                ppu.window_rendered = false;
-                ppu.line_dots = 0;
-            }
-            io_ram[address_offset] = byte;
-            return;
-        }
-        case DMA:
-            io_ram[address_offset] = byte;
-            set_oam_dma_transfer(true);
             return;
+        case DIV:
+        case TIMA:
+        case TMA:
+        case TAC: write_timer_register(address, byte); return;
+        case IF: set_interrupt_flags(byte); return;
+        case IE: set_interrupt_enable(byte); return;
         default: io_ram[address_offset] = byte; return;
     }
 }
 
-void set_memory_byte(uint16_t address, uint8_t byte) {
+static void handle_mbc_write(uint16_t address, uint8_t byte) {
+    uint16_t bank_x0 = gb->memory.mbc.get_rom_bank(ROM_BANK_00_BASE);
+    uint16_t bank_01 = gb->memory.mbc.get_rom_bank(ROM_BANK_NN_BASE);
+    gb->memory.mbc.set_memory_byte(address, byte);
+    map_cartridge_pages();
+    if (bank_x0 != gb->memory.mbc.get_rom_bank(ROM_BANK_00_BASE) ||
+        bank_01 != gb->memory.mbc.get_rom_bank(ROM_BANK_NN_BASE)) {
+        invalidate_block_cursor();
+    }
+}
+
+static void write_unmapped_byte(uint16_t address, uint8_t byte) {
+    if (gb->memory.bus_blocked && address < IO_RAM_BASE) {
+        return;
+    }
     if (address >= ROM_BANK_00_BASE && address < ROM_BANK_NN_BASE) {
-        mbc.set_memory_byte(address, byte);
+        handle_mbc_write(address, byte);
     } else if (address >= ROM_BANK_NN_BASE && address < VRAM_BASE) {
-        mbc.set_memory_byte(address, byte);
+        handle_mbc_write(address, byte);
     } else if (address >= VRAM_BASE && address < EX_RAM_BASE) {
-        if (ppu.mode == 3) {
+        // The lines the PPU hasn't drawn yet have to see the old value
+        catch_up_ppu();
+        if (gb->ppu.mode == 3) {
             return;
         }
-        vram[address - VRAM_BASE] = byte;
+        gb->memory.vram[address - VRAM_BASE] = byte;
+        invalidate_tile(address);
+        forward_to_render_worker(address, byte);
     } else if (address >= EX_RAM_BASE && address < WRAM_BASE) {
-        mbc.set_memory_byte(address, byte);
+        gb->memory.mbc.set_memory_byte(address, byte);
     } else if (address >= WRAM_BASE && address < ECHO_RAM_BASE) {
-        wram[address - WRAM_BASE] = byte;
+        gb->memory.wram[address - WRAM_BASE] = byte;
     } else if (address >= ECHO_RAM_BASE && address < OAM_BASE) {
-        wram[address - 0x2000 - WRAM_BASE] = byte;
+        gb->memory.wram[address - 0x2000 - WRAM_BASE] = byte;
     } else if (address >= OAM_BASE && address < PROHIBITED_BASE) {
-        if (ppu.mode == 2 || ppu.mode == 3) {
+        catch_up_ppu();
+        if (gb->ppu.mode == 2 || gb->ppu.mode == 3) {
             return;
         }
-        oam[address - OAM_BASE] = byte;
+        gb->memory.oam[address - OAM_BASE] = byte;
+        forward_to_render_worker(address, byte);
     } else if (address >= PROHIBITED_BASE && address < IO_RAM_BASE) {
         return;
     } else if (address >= IO_RAM_BASE) {
@@ -376,15 +528,31 @@ void set_memory_byte(uint16_t address, uint8_t byte) {
     }
 }
 
+void set_memory_byte(uint16_t address, uint8_t byte) {
+    uint8_t *page = gb->memory.write_pages[address / MEMORY_PAGE_SIZE];
+    if (page) {
+        page[address % MEMORY_PAGE_SIZE] = byte;
+        return;
+    }
+    write_unmapped_byte(address, byte);
+}
+
 void save_data(void) {
+    if (!gb->memory.save_location_filename[0]) {
+        return;
+    }
     struct stat st = {0};
-    if (stat(SAVE_DIR, &st) == -1) {
-        mkdir(SAVE_DIR, 0700);
+    if (stat(gb->memory.save_directory, &st) == -1) {
+        mkdir(gb->memory.save_directory, 0700);
+    }
+    FILE *save_location = fopen(gb->memory.save_location_filename, "w");
+    if (!save_location) {
+        return;
     }
-    FILE *save_location = fopen(save_location_filename, "w");
-    if (mbc.save_data) {
-        mbc.save_data(save_location);
+    if (gb->memory.mbc.save_data) {
+        gb->memory.mbc.save_data(save_location);
     }
+    fclose(save_location);
 }
 
 void load_save_data(char *save_location_file_name) {
@@ -392,7 +560,8 @@ void load_save_data(char *save_location_file_name) {
     if (!save_location) {
         return;
     }
-    if (mbc.load_save_data) {
-        mbc.load_save_data(save_location);
+    if (gb->memory.mbc.load_save_data) {
+        gb->memory.mbc.load_save_data(save_location);
     }
+    fclose(save_location);
 }
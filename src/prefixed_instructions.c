@@ -2,7 +2,6 @@
 #include "instructions.h"
 #include "utils.h"
 #include <inttypes.h>
-#include <ncurses.h>
 
 clock_cycles_t BIT_B_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t OPCODE = get_opcode(instruction);
@@ -25,10 +24,7 @@ clock_cycles_t RL_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t bit7 = get_bit(get_register(src), 7);
     uint8_t result = (uint8_t)(get_register(src) << 1 | get_flag(C_FLAG));
 
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags(!result, 0, 0, bit7);
 
     set_register(src, result);
 
@@ -44,10 +40,7 @@ clock_cycles_t RLC_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t bit7 = get_bit(get_register(src), 7);
     uint8_t result = (uint8_t)(get_register(src) << 1 | bit7);
 
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, bit7);
 
     set_register(src, result);
 
@@ -62,10 +55,7 @@ clock_cycles_t RLC_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t bit7 = get_bit(HL_val, 7);
     uint8_t result = (uint8_t)(HL_val << 1 | bit7);
 
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, bit7);
 
     set_memory_byte(get_long_reg(HL), result);
 
@@ -78,10 +68,7 @@ clock_cycles_t RRC_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t bit0 = get_bit(get_register(src), 0);
     uint8_t result = (uint8_t)(get_register(src) >> 1 | bit0 << 7);
 
-    bit0 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, bit0);
 
     set_register(src, result);
 
@@ -96,10 +83,7 @@ clock_cycles_t RRC_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t bit0 = get_bit(HL_val, 0);
     uint8_t result = (uint8_t)(HL_val >> 1 | bit0 << 7);
 
-    bit0 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, bit0);
 
     set_memory_byte(get_long_reg(HL), result);
 
@@ -115,10 +99,7 @@ clock_cycles_t RL_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t bit7 = get_bit(HL_val, 7);
     uint8_t result = (uint8_t)(HL_val << 1 | get_flag(C_FLAG));
 
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags(!result, 0, 0, bit7);
 
     set_memory_byte(get_long_reg(HL), result);
 
@@ -130,10 +111,7 @@ clock_cycles_t RR_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     reg_t src = OPCODE & 0x07;
     uint8_t result = (uint8_t)(get_register(src) >> 1 | get_flag(C_FLAG) << 7);
-    get_register(src) & 0x01 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, get_register(src) & 0x01);
 
     set_register(src, result);
     set_decoded_instruction("RR %c", REGISTER_CHAR(src));
@@ -144,10 +122,7 @@ clock_cycles_t RR_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
     uint8_t HL_val = get_memory_byte(get_long_reg(HL));
     uint8_t result = (uint8_t)(HL_val >> 1 | get_flag(C_FLAG) << 7);
-    HL_val & 0x01 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, HL_val & 0x01);
 
     set_memory_byte(get_long_reg(HL), result);
     return SIXTEEN_CLOCKS;
@@ -158,10 +133,7 @@ clock_cycles_t SLA_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     reg_t src = OPCODE & 0x07;
     uint8_t result = (uint8_t)(get_register(src) << 1);
-    get_bit(get_register(src), 7) ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, get_bit(get_register(src), 7));
 
     set_register(src, result);
     set_decoded_instruction("SLA %c", REGISTER_CHAR(src));
@@ -172,10 +144,7 @@ clock_cycles_t SLA_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
     uint8_t HL_val = get_memory_byte(get_long_reg(HL));
     uint8_t result = (uint8_t)(HL_val << 1);
-    get_bit(HL_val, 7) ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, get_bit(HL_val, 7));
 
     set_memory_byte(get_long_reg(HL), result);
 
@@ -186,10 +155,7 @@ clock_cycles_t SRA_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t OPCODE = get_opcode(instruction);
     reg_t src = OPCODE & 0x07;
     uint8_t result = (get_register(src) >> 1) | (get_register(src) & 0x80);
-    get_bit(get_register(src), 0) ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, get_bit(get_register(src), 0));
 
     set_register(src, result);
     set_decoded_instruction("SRA %c", REGISTER_CHAR(src));
@@ -200,10 +166,7 @@ clock_cycles_t SRA_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
     uint8_t HL_val = get_memory_byte(get_long_reg(HL));
     uint8_t result = (HL_val >> 1) | (HL_val & 0x80);
-    get_bit(HL_val, 0) ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(!result, 0, 0, get_bit(HL_val, 0));
 
     set_memory_byte(get_long_reg(HL), result);
 
@@ -217,10 +180,7 @@ clock_cycles_t SWAP_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t reg_val = get_register(src);
     uint8_t new_val = (uint8_t)((reg_val & 0x0F) << 4 | (reg_val & 0xF0) >> 4);
     set_register(src, new_val);
-    new_val ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!new_val, 0, 0, 0);
     set_decoded_instruction("SWAP %c", REGISTER_CHAR(src));
     return EIGHT_CLOCKS;
 }
@@ -231,10 +191,7 @@ clock_cycles_t SWAP_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t HL_val = get_memory_byte(get_long_reg(HL));
     uint8_t reg_val = HL_val;
     uint8_t new_val = (uint8_t)((reg_val & 0x0F) << 4 | (reg_val & 0xF0) >> 4);
-    new_val ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!new_val, 0, 0, 0);
 
     set_memory_byte(get_long_reg(HL), new_val);
     return SIXTEEN_CLOCKS;
@@ -247,10 +204,7 @@ clock_cycles_t SRL_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t reg_val = get_register(src);
     uint8_t bit0 = reg_val & 0x01;
     uint8_t result = reg_val >> 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    bit0 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, bit0);
     set_register(src, result);
     set_decoded_instruction("SRL %c", REGISTER_CHAR(src));
     return EIGHT_CLOCKS;
@@ -261,10 +215,7 @@ clock_cycles_t SRL_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t HL_val = get_memory_byte(get_long_reg(HL));
     uint8_t bit0 = HL_val & 0x01;
     uint8_t result = HL_val >> 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    bit0 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, bit0);
 
     set_memory_byte(get_long_reg(HL), result);
     return SIXTEEN_CLOCKS;
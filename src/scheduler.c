@@ -0,0 +1,146 @@
+#include "scheduler.h"
+#include "context.h"
+#include "oam_queue.h"
+#include "ppu.h"
+#include <stdbool.h>
+
+#define NOT_QUEUED -1
+
+typedef void (*event_handler_t)(void);
+
+static const event_handler_t event_handlers[NUM_OF_EVENTS] = {
+    [TIMER_EVENT] = &handle_timer_event,
+    [PPU_EVENT] = &handle_ppu_event,
+    [OAM_DMA_EVENT] = &handle_oam_dma_event,
+};
+
+// The rest stay unscheduled until the hardware behind them is started
+static const bool scheduled_at_startup[NUM_OF_EVENTS] = {
+    [TIMER_EVENT] = true,
+    [PPU_EVENT] = true,
+};
+
+static bool is_earlier(const Scheduler *scheduler, int a, int b) {
+    const uint64_t DEADLINE_A = scheduler->deadlines[scheduler->queue[a]];
+    const uint64_t DEADLINE_B = scheduler->deadlines[scheduler->queue[b]];
+    if (DEADLINE_A != DEADLINE_B) {
+        return DEADLINE_A < DEADLINE_B;
+    }
+    // Events due together run in the order the hardware used to be updated
+    return scheduler->queue[a] < scheduler->queue[b];
+}
+
+static void swap_entries(Scheduler *scheduler, int a, int b) {
+    event_t event = scheduler->queue[a];
+    scheduler->queue[a] = scheduler->queue[b];
+    scheduler->queue[b] = event;
+    scheduler->queue_position[scheduler->queue[a]] = a;
+    scheduler->queue_position[scheduler->queue[b]] = b;
+}
+
+static void sift_up(Scheduler *scheduler, int position) {
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!is_earlier(scheduler, position, parent)) {
+            return;
+        }
+        swap_entries(scheduler, position, parent);
+        position = parent;
+    }
+}
+
+static void sift_down(Scheduler *scheduler, int position) {
+    while (true) {
+        int earliest = position;
+        int left = 2 * position + 1;
+        int right = left + 1;
+        if (left < scheduler->queue_length &&
+            is_earlier(scheduler, left, earliest)) {
+            earliest = left;
+        }
+        if (right < scheduler->queue_length &&
+            is_earlier(scheduler, right, earliest)) {
+            earliest = right;
+        }
+        if (earliest == position) {
+            return;
+        }
+        swap_entries(scheduler, position, earliest);
+        position = earliest;
+    }
+}
+
+static void update_next_deadline(Scheduler *scheduler) {
+    scheduler->next_deadline = scheduler->queue_length
+                                   ? scheduler->deadlines[scheduler->queue[0]]
+                                   : UINT64_MAX;
+}
+
+void initialize_scheduler(void) {
+    Scheduler *scheduler = &gb->scheduler;
+    scheduler->cycles = 0;
+    scheduler->queue_length = 0;
+    for (int event = 0; event < NUM_OF_EVENTS; event++) {
+        scheduler->queue_position[event] = NOT_QUEUED;
+    }
+    // These components work out their own deadline after the first instruction
+    for (int event = 0; event < NUM_OF_EVENTS; event++) {
+        if (scheduled_at_startup[event]) {
+            schedule_event((event_t)event, 1);
+        }
+    }
+}
+
+uint64_t get_cycles(void) { return gb->scheduler.cycles; }
+
+uint64_t get_next_event_cycle(void) { return gb->scheduler.next_deadline; }
+
+uint64_t get_handled_event_count(void) { return gb->scheduler.handled_events; }
+
+void schedule_event(event_t event, uint64_t cycle) {
+    Scheduler *scheduler = &gb->scheduler;
+    const uint64_t OLD_DEADLINE = scheduler->deadlines[event];
+    int position = scheduler->queue_position[event];
+    scheduler->deadlines[event] = cycle;
+    if (position == NOT_QUEUED) {
+        position = scheduler->queue_length++;
+        scheduler->queue[position] = event;
+        scheduler->queue_position[event] = position;
+        sift_up(scheduler, position);
+    } else if (cycle < OLD_DEADLINE) {
+        sift_up(scheduler, position);
+    } else {
+        sift_down(scheduler, position);
+    }
+    update_next_deadline(scheduler);
+}
+
+void cancel_event(event_t event) {
+    Scheduler *scheduler = &gb->scheduler;
+    int position = scheduler->queue_position[event];
+    if (position == NOT_QUEUED) {
+        return;
+    }
+    swap_entries(scheduler, position, --scheduler->queue_length);
+    scheduler->queue_position[event] = NOT_QUEUED;
+    if (position < scheduler->queue_length) {
+        sift_up(scheduler, position);
+        sift_down(scheduler, position);
+    }
+    update_next_deadline(scheduler);
+}
+
+/*
+ * Moves time forward by the clocks the CPU just spent and runs every event
+ * that has come due. Handlers are expected to schedule their next event.
+ */
+void advance_cycles(clock_cycles_t clocks) {
+    Scheduler *scheduler = &gb->scheduler;
+    scheduler->cycles += (uint64_t)clocks;
+    while (scheduler->next_deadline <= scheduler->cycles) {
+        event_t event = scheduler->queue[0];
+        cancel_event(event);
+        scheduler->handled_events++;
+        event_handlers[event]();
+    }
+}
@@ -24,11 +24,7 @@ clock_cycles_t XOR_A_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     uint8_t result = get_register(A) ^ get_register(src);
     set_register(A, result);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
-
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags(!result, 0, 0, 0);
     set_decoded_instruction("XOR A, %c", REGISTER_CHAR(src));
     return FOUR_CLOCKS;
 }
@@ -37,10 +33,7 @@ clock_cycles_t XOR_A_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
 
     uint8_t result = get_register(A) ^ get_memory_byte(get_long_reg(HL));
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags(!result, 0, 0, 0);
     set_register(A, result);
     set_decoded_instruction("XOR A, (HL)");
     return EIGHT_CLOCKS;
@@ -82,10 +75,7 @@ clock_cycles_t AND_A_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     reg_t src = OPCODE & 0x7;
 
     uint8_t result = get_register(A) & get_register(src);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    set_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 1, 0);
 
     set_register(A, result);
 
@@ -97,10 +87,7 @@ clock_cycles_t AND_A_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 clock_cycles_t AND_A_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
     uint8_t result = get_register(A) & get_memory_byte(get_long_reg(HL));
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    set_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 1, 0);
 
     set_register(A, result);
 
@@ -125,10 +112,7 @@ clock_cycles_t INC_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     reg_t src = (OPCODE >> 3) & 0x7;
 
     uint8_t result = get_register(src) + 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    half_carry_on_add(get_register(src), 1, 0) ? set_flag(H_FLAG)
-                                               : reset_flag(H_FLAG);
+    set_flags_inc(get_register(src));
 
     set_register(src, result);
 
@@ -142,10 +126,7 @@ clock_cycles_t DEC_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t OPCODE = get_opcode(instruction);
     reg_t src = (OPCODE >> 3) & 0x7;
     uint8_t result = get_register(src) - 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    set_flag(N_FLAG);
-    half_carry_on_subtract(get_register(src), 1, 0) ? set_flag(H_FLAG)
-                                                    : reset_flag(H_FLAG);
+    set_flags_dec(get_register(src));
 
     set_register(src, result);
 
@@ -486,10 +467,7 @@ clock_cycles_t RLA(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     uint8_t bit7 = get_bit(get_register(A), 7);
     uint8_t result = (uint8_t)(get_register(A) << 1 | get_flag(C_FLAG));
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(Z_FLAG);
+    set_flags(0, 0, 0, bit7);
     set_register(A, result);
     set_decoded_instruction("RLA");
     return FOUR_CLOCKS;
@@ -563,10 +541,7 @@ clock_cycles_t RLCA(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     set_decoded_instruction("RLCA");
     const uint8_t bit7 = get_bit(get_register(A), 7);
-    bit7 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    reset_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(0, 0, 0, bit7);
     uint8_t result = get_register(A) << 1 | bit7;
     set_register(A, result);
     return FOUR_CLOCKS;
@@ -577,11 +552,8 @@ clock_cycles_t RRCA(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     set_decoded_instruction("RRCA");
     const uint8_t bit0 = get_bit(get_register(A), 0);
-    bit0 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
     uint8_t result = get_register(A) >> 1 | bit0 << 7;
-    reset_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(0, 0, 0, bit0);
     set_register(A, result);
     return FOUR_CLOCKS;
 }
@@ -620,10 +592,7 @@ clock_cycles_t ADD_HL_SP(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 clock_cycles_t RRA(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
     uint8_t result = (uint8_t)(get_register(A) >> 1 | get_flag(C_FLAG) << 7);
-    get_register(A) & 0x01 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    reset_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
+    set_flags(0, 0, 0, get_register(A) & 0x01);
     set_register(A, result);
 
     set_decoded_instruction("RRA");
@@ -673,11 +642,9 @@ clock_cycles_t INC_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     (void)instruction;
 
     uint16_t HL_val = get_long_reg(HL);
-    uint8_t result = get_memory_byte(HL_val) + 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    half_carry_on_add(get_memory_byte(HL_val), 1, 0) ? set_flag(H_FLAG)
-                                                     : reset_flag(H_FLAG);
+    const uint8_t val = get_memory_byte(HL_val);
+    uint8_t result = val + 1;
+    set_flags_inc(val);
     set_memory_byte(HL_val, result);
 
     set_decoded_instruction("INC (HL)");
@@ -690,11 +657,9 @@ clock_cycles_t DEC_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     set_decoded_instruction("DEC (HL)");
     const uint16_t HL_val = get_long_reg(HL);
-    uint8_t result = get_memory_byte(HL_val) - 1;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    set_flag(N_FLAG);
-    half_carry_on_subtract(get_memory_byte(HL_val), 1, 0) ? set_flag(H_FLAG)
-                                                          : reset_flag(H_FLAG);
+    const uint8_t val = get_memory_byte(HL_val);
+    uint8_t result = val - 1;
+    set_flags_dec(val);
 
     set_memory_byte(HL_val, result);
 
@@ -792,10 +757,7 @@ clock_cycles_t OR_A_R(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     uint8_t result = get_register(A) | get_register(src);
     set_register(A, result);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, 0);
 
     set_decoded_instruction("OR A, %c", REGISTER_CHAR(src));
 
@@ -809,10 +771,7 @@ clock_cycles_t OR_A_DEREF_HL(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     uint8_t result = get_register(A) | get_memory_byte(get_long_reg(HL));
     set_register(A, result);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, 0);
 
     return EIGHT_CLOCKS;
 }
@@ -993,10 +952,7 @@ clock_cycles_t AND_A_IMM(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint8_t imm = instruction[1];
     uint8_t result = get_register(A) & imm;
     set_register(A, result);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    set_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 1, 0);
 
     set_decoded_instruction("AND A, 0x%X", imm);
 
@@ -1011,15 +967,8 @@ clock_cycles_t ADD_SP_IMM(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     const uint16_t result = get_sp() + signed_imm;
 
     const uint8_t imm = instruction[1];
-
-    half_carry_on_add(imm, get_sp() & 0xFF, 0) ? set_flag(H_FLAG)
-                                               : reset_flag(H_FLAG);
-
-    ((get_sp() & 0xFF) + (uint16_t)imm > UINT8_MAX) ? set_flag(C_FLAG)
-                                                    : reset_flag(C_FLAG);
-
-    reset_flag(Z_FLAG);
-    reset_flag(N_FLAG);
+    set_flags(0, 0, half_carry_on_add(imm, get_sp() & 0xFF, 0),
+              (get_sp() & 0xFF) + (uint16_t)imm > UINT8_MAX);
     set_sp(result);
     set_decoded_instruction("ADD SP, 0x%X", signed_imm);
     return SIXTEEN_CLOCKS;
@@ -1039,10 +988,7 @@ clock_cycles_t XOR_A_IMM(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
 
     const uint8_t imm = instruction[1];
     uint8_t result = get_register(A) ^ imm;
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, 0);
 
     set_register(A, result);
     set_decoded_instruction("XOR A, 0x%X", imm);
@@ -1074,10 +1020,7 @@ clock_cycles_t OR_A_IMM(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     uint8_t imm = instruction[1];
     uint8_t result = get_register(A) | imm;
     set_register(A, result);
-    result ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
-    reset_flag(N_FLAG);
-    reset_flag(H_FLAG);
-    reset_flag(C_FLAG);
+    set_flags(!result, 0, 0, 0);
     set_decoded_instruction("OR A, 0x%X", imm);
 
     return FOUR_CLOCKS;
@@ -1091,14 +1034,8 @@ clock_cycles_t LD_HL_SP_PLUS_IMM(uint8_t instruction[MAX_INSTRUCTION_SIZE]) {
     set_long_reg_u16(HL, result);
 
     const uint8_t imm = instruction[1];
-    half_carry_on_add(imm, get_sp() & 0xFF, 0) ? set_flag(H_FLAG)
-                                               : reset_flag(H_FLAG);
-
-    ((get_sp() & 0xFF) + (uint16_t)imm > UINT8_MAX) ? set_flag(C_FLAG)
-                                                    : reset_flag(C_FLAG);
-
-    reset_flag(Z_FLAG);
-    reset_flag(N_FLAG);
+    set_flags(0, 0, half_carry_on_add(imm, get_sp() & 0xFF, 0),
+              (get_sp() & 0xFF) + (uint16_t)imm > UINT8_MAX);
     set_decoded_instruction("LD HL, SP + %#X", imm);
 
     return TWELVE_CLOCKS;
@@ -12,16 +12,6 @@ void check_alloc(void *allocated_block, const char *msg_on_failure) {
     }
 }
 
-void mvwprintwhcenter(WINDOW *win, int row, int row_start, int width,
-                      const char *str, ...) {
-    char formatted_string[UINT8_MAX];
-    va_list args;
-    va_start(args, str);
-    vsnprintf(formatted_string, UINT8_MAX, str, args);
-    int len = (int)strnlen(formatted_string, UINT8_MAX);
-    mvwprintw(win, row, row_start + (width / 2) - (len / 2), formatted_string);
-}
-
 uint16_t post_inc(uint16_t *val) { return (*val)++; }
 
 void u16_to_two_u8s(uint16_t val, uint8_t *b1, uint8_t *b2) {
@@ -35,11 +25,7 @@ bool half_carry_on_subtract(uint8_t val_1, uint8_t val_2, uint8_t carry) {
 
 uint8_t sub(uint8_t val_1, uint8_t val_2, uint8_t carry) {
     uint8_t res = val_1 - val_2 - carry;
-    (val_2 + carry) > val_1 ? set_flag(C_FLAG) : reset_flag(C_FLAG);
-    half_carry_on_subtract(val_1, val_2, carry) ? set_flag(H_FLAG)
-                                                : reset_flag(H_FLAG);
-    set_flag(N_FLAG);
-    res ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags_sub(val_1, val_2, carry);
     return res;
 }
 
@@ -53,29 +39,13 @@ bool half_carry_on_add16(uint16_t val_1, uint16_t val_2) {
 
 uint8_t add(uint8_t val_1, uint8_t val_2, uint8_t carry) {
     uint16_t res = val_1 + val_2 + carry;
-    half_carry_on_add(val_1, val_2, carry) ? set_flag(H_FLAG)
-                                           : reset_flag(H_FLAG);
-    reset_flag(N_FLAG);
-    if (res > UINT8_MAX) {
-        set_flag(C_FLAG);
-        res -= (UINT8_MAX + 1);
-    } else {
-        reset_flag(C_FLAG);
-    }
-    res ? reset_flag(Z_FLAG) : set_flag(Z_FLAG);
+    set_flags_add(val_1, val_2, carry);
     return (uint8_t)res;
 }
 
 uint16_t addu16(uint16_t val_1, uint16_t val_2) {
     uint32_t res = val_2 + val_1;
-    reset_flag(N_FLAG);
-    if (res > UINT16_MAX) {
-        set_flag(C_FLAG);
-        res -= (UINT16_MAX + 1);
-    } else {
-        reset_flag(C_FLAG);
-    }
-    half_carry_on_add16(val_2, val_1) ? set_flag(H_FLAG) : reset_flag(H_FLAG);
+    set_flags_add16(val_1, val_2);
     return (uint16_t)res;
 }
 